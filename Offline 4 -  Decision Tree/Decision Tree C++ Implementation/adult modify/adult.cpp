@@ -1,161 +1,201 @@
 #include "attributeLibrary.hpp"
 #include "datasetLibrary.hpp"
 #include "selectionCriteriaLibrary.hpp"
-#include "dtLibrary.hpp"
+#include "DTLibrary.hpp"
+#include "experimentLibrary.hpp"
+#include "pruningLibrary.hpp"
+#include "modelLibrary.hpp"
 
 #include <bits/stdc++.h>
 using namespace std;
 
-void loadIrisCSV(const string& filename, Dataset& dataset) {
-    ifstream file(filename);
-    string line; 
-
-    while (getline(file, line)) {
-        stringstream ss(line);
-        vector<string> cells;
-        string cell;
-
-        while (getline(ss, cell, ',')) {
-            cells.push_back(cell);
-        }
-
-        // Ensure the row has enough values (attributes + label)
-        if (cells.size() != dataset.attributes.size() + 1) {
-            continue; // Skip malformed rows
-        }
+// The grid of run() and runBinningDrift: unbounded trees of every
+// criterion on one seeded split, as many as the driver always ran
+ExperimentGrid adultGrid(int threads) {
+    ExperimentGrid grid;
+    grid.maxDepths = {INT_MAX};
+    grid.repetitions = 1;
+    grid.threads = threads;
+    grid.output = "adult_imputed_results.csv";
+    return grid;
+}
 
-        vector<string> rowData;
-        for (size_t i = 0; i < dataset.attributes.size(); ++i) {
-            rowData.push_back(cells[i]);
-        }
-        string label = cells.back();
+// Runs adultGrid (see runExperiment). The trees of its first split are
+// grown once more with `threads` threads and saved, so predict.cpp scores
+// the same trees the results describe.
+void run(const Dataset& dataset, int threads) {
+    ExperimentGrid grid = adultGrid(threads);
+    vector<ExperimentCell> cells = runExperiment(dataset, grid);
+    writeExperimentCSV(cells, grid.output);
+    for (const ExperimentCell &cell : cells) {
+        SelectionCriteria criterion = cell.criterion;
+        string criterionName = (criterion == InformationGain ? "IG" :
+                               (criterion == InformationGainRatio ? "IGR" : "NWIG"));
+        cout << "==== MaxDepth = " << cell.maxDepth << ", Criterion = " << criterionName << " ====\n"
+             << "  Avg Build Time: " << fixed << setprecision(4) << cell.buildTime / 1000 << "s\n"
+             << "  Avg Tree Size: " << static_cast<int>(cell.treeSize) << "\n"
+             << "  Avg Accuracy: " << fixed << setprecision(2) << cell.accuracy << "%\n\n";
+    }
 
-        dataset.rows.push_back(rowData);
-        dataset.labels.push_back(label);
+    pair<Dataset, Dataset> split = trainTestSplitRandom(dataset, grid.trainSize, grid.seedFor(0));
+    TreeOptions options = grid.options;
+    options.maxDepth = INT_MAX;
+    options.threads = threads;
+    vector<DecisionTree> trees = DecisionTree::growTogether(split.first, grid.criteria, options);
+    for (size_t c = 0; c < trees.size(); ++c) {
+        SelectionCriteria criterion = grid.criteria[c];
+        string criterionName = (criterion == InformationGain ? "IG" :
+                               (criterion == InformationGainRatio ? "IGR" : "NWIG"));
+        // Scored later without retraining by predict.cpp
+        saveModel(trees[c], "adult_" + criterionName + ".model");
+        // Built with -DDT_PROFILE: where the training time went
+        DT_PROFILE_ONLY(
+            trees[c].profile.writeJSON("adult_profile_" + criterionName + ".json");
+            trees[c].profile.writeCSV("adult_profile_" + criterionName + ".csv");
+        )
     }
 }
 
-
-void run(Dataset& dataset) {
-    int times=1;
-    vector<int> maxDepths = {INT_MAX};
-    vector<SelectionCriteria> criteria = {
-        InformationGain, 
-        InformationGainRatio, 
-        NormalizedWeightedInformationGain
-    };
-    ofstream outputFile("adult_imputed_results.csv");
-    outputFile << "Max Depth,Selection Criteria,TrainTime(s),TreeSize,Accuracy(%)\n";
-
-    for (int maxDepth : maxDepths) {
-        for (SelectionCriteria criterion : criteria) {
-
+// Same grid and splits as run() (adultGrid), but every split trains an
+// exact tree and a histogram tree over `bins` bins and records the
+// accuracy drift between them. The bins come from the training rows only,
+// as they would in production.
+void runBinningDrift(const Dataset& dataset, int threads, int bins) {
+    ExperimentGrid grid = adultGrid(threads);
+    int times = grid.repetitions;
+    ofstream outputFile("adult_binning_drift.csv");
+    outputFile << "Max Depth,Selection Criteria,Bins,ExactAccuracy(%),BinnedAccuracy(%),Drift(%)\n";
+
+    for (int maxDepth : grid.maxDepths) {
+        for (SelectionCriteria criterion : grid.criteria) {
             string criterionName = (criterion == InformationGain ? "IG" :
                                    (criterion == InformationGainRatio ? "IGR" : "NWIG"));
-            cout << "==== Running for MaxDepth = " << maxDepth 
-                 << ", Criterion = " << criterionName <<endl;
-
-            double avgTrainTime = 0.0, avgAccuracy = 0.0, avgTreeSize = 0.0;
-
-            
-                pair<Dataset, Dataset> split = trainTestSplitRandom(dataset, 0.8);
-
-                
-                auto start = chrono::high_resolution_clock::now();
-                DecisionTree dt(split.first, criterion, maxDepth);
-                auto end = chrono::high_resolution_clock::now();
-                chrono::duration<double> trainTime = end - start;
-                avgTrainTime += trainTime.count();
-                
-
-                avgTreeSize += dt.getSize();
-
-                
-                auto testStart = chrono::high_resolution_clock::now();
-                int correctPredictions = 0;
-                for (auto& row : split.second.rows) {
-                    string predictedLabel = dt.predictLabel(row);
-                    string actualLabel = split.second.labels[&row - &split.second.rows[0]];
-                    if (predictedLabel == actualLabel) {
-                        correctPredictions++;
-                    }
+            double exactAccuracy = 0.0, binnedAccuracy = 0.0;
+
+            for (int i = 0; i < times; i++) {
+                pair<Dataset, Dataset> split = trainTestSplitRandom(dataset, grid.trainSize, grid.seedFor(i));
+                split.first.quantize(bins);
+                TreeOptions binned(maxDepth, threads);
+                binned.histogramSplits = true;
+                binned.maxBins = bins;
+                DecisionTree exactTree(split.first, criterion, maxDepth, threads);
+                DecisionTree binnedTree(split.first, criterion, binned);
+
+                int exactCorrect = 0, binnedCorrect = 0;
+                for (size_t row = 0; row < split.second.size(); ++row) {
+                    exactCorrect += exactTree.predictClass(split.second, row) == split.second.labels[row];
+                    binnedCorrect += binnedTree.predictClass(split.second, row) == split.second.labels[row];
                 }
-                auto testEnd = chrono::high_resolution_clock::now();
-                chrono::duration<double> testTime = testEnd - testStart;
-                cout << " done in " << testTime.count() << "s" << endl;
-
-                double accuracy = static_cast<double>(correctPredictions) / split.second.rows.size() * 100.0;
-                avgAccuracy += accuracy;
-                
-            
+                exactAccuracy += static_cast<double>(exactCorrect) / split.second.size() * 100.0;
+                binnedAccuracy += static_cast<double>(binnedCorrect) / split.second.size() * 100.0;
+            }
 
             outputFile << maxDepth << ","
                        << criterionName << ","
-                       << fixed << setprecision(4) << (avgTrainTime / times) << ","
-                       << static_cast<int>(avgTreeSize / times) << ","
-                       << fixed << setprecision(2) << (avgAccuracy / times) << endl;
-
-            cout << "==== Finished MaxDepth = " << maxDepth 
-                 << ", Criterion = " << criterionName << " ====\n"
-                 << "  Avg Train Time: " << fixed << setprecision(4) << (avgTrainTime / times) << "s\n"
-                 << "  Avg Tree Size: " << static_cast<int>(avgTreeSize / times) << "\n"
-                 << "  Avg Accuracy: " << fixed << setprecision(2) << (avgAccuracy / times) << "%\n\n";
+                       << bins << ","
+                       << fixed << setprecision(2) << (exactAccuracy / times) << ","
+                       << (binnedAccuracy / times) << ","
+                       << ((binnedAccuracy - exactAccuracy) / times) << endl;
         }
     }
 
     outputFile.close();
 }
 
+// Trains unbounded trees on 60% of the rows and prunes them against the
+// next 20%: cost-complexity pruning to the smallest tree within `tolerance`
+// points of the best validation accuracy, and reduced-error pruning. The
+// last 20% measures every tree. Both splits are seeded (see
+// ExperimentGrid::seedFor), so the report can be reproduced.
+void runPruning(const Dataset& dataset, int threads, double tolerance) {
+    ExperimentGrid grid;
+    vector<SelectionCriteria> criteria = {
+        InformationGain, 
+        InformationGainRatio, 
+        NormalizedWeightedInformationGain
+    };
+    ofstream outputFile("adult_pruning.csv");
+    outputFile << "Selection Criteria,Pruning,Alpha,TreeSize,Accuracy(%),PruneTime(s)\n";
+
+    pair<Dataset, Dataset> split = trainTestSplitRandom(dataset, 0.8, grid.seedFor(0));
+    pair<Dataset, Dataset> training = trainTestSplitRandom(split.first, 0.75, grid.seedFor(1));
+    // One pool scores all the trees; a single thread needs none
+    unique_ptr<ThreadPool> threadPool;
+    if (threads > 1) threadPool = make_unique<ThreadPool>(threads - 1);
+    auto accuracy = [&](const DecisionTree &tree) {
+        vector<int> predictedClasses;
+        if (threadPool) tree.predictBatch(split.second, predictedClasses, *threadPool);
+        else tree.predictBatch(split.second, predictedClasses, 1);
+        int correctPredictions = 0;
+        for (size_t row = 0; row < split.second.size(); ++row) {
+            correctPredictions += predictedClasses[row] == split.second.labels[row];
+        }
+        return static_cast<double>(correctPredictions) / split.second.size() * 100.0;
+    };
+
+    for (SelectionCriteria criterion : criteria) {
+        string criterionName = (criterion == InformationGain ? "IG" :
+                               (criterion == InformationGainRatio ? "IGR" : "NWIG"));
+        DecisionTree full(training.first, criterion, INT_MAX, threads);
+        outputFile << criterionName << ",none,0," << full.getSize() << "," << fixed << setprecision(2)
+                   << accuracy(full) << ",0" << endl;
+
+        DecisionTree costComplexity = full;
+        auto start = chrono::high_resolution_clock::now();
+        double alpha = pruneWithinTolerance(costComplexity, training.second, tolerance);
+        auto end = chrono::high_resolution_clock::now();
+        outputFile << criterionName << ",cost-complexity," << setprecision(6) << alpha << ","
+                   << costComplexity.getSize() << "," << setprecision(2) << accuracy(costComplexity) << ","
+                   << setprecision(4) << chrono::duration<double>(end - start).count() << endl;
+
+        DecisionTree reducedError = full;
+        start = chrono::high_resolution_clock::now();
+        pruneReducedError(reducedError, training.second);
+        end = chrono::high_resolution_clock::now();
+        outputFile << criterionName << ",reduced-error,," << reducedError.getSize() << "," << setprecision(2)
+                   << accuracy(reducedError) << "," << setprecision(4)
+                   << chrono::duration<double>(end - start).count() << endl;
+    }
 
+    outputFile.close();
+}
 
+//   adult [threads] [bins] [tolerance]
+//
+// run() covers every criterion at unbounded depth, so neither is an argument.
 int main(int argc, char* argv[]) {
-    string criterionStr = (argc > 1) ? argv[1] : "IGR";
-    int maxDepth = (argc > 2) ? stoi(argv[2]) : 4;
-
-    
-    SelectionCriteria criterion;
-    if (criterionStr == "IG") {
-        criterion = InformationGain;
-    } else if (criterionStr == "IGR") {
-        criterion = InformationGainRatio;
-    } else if (criterionStr == "NWIG") {
-        criterion = NormalizedWeightedInformationGain;
-    } else {
-        cout << "Invalid criterion. Choose IG, IGR, or NWIG.\n";
-        return 1;
-    }
+    int threads = (argc > 1) ? stoi(argv[1]) : max(1u, thread::hardware_concurrency());
 
     Dataset dataset;
     dataset.name = "Adult Dataset";
-    vector<Attributes> attributes = {
-        Attributes("Age", "numerical", {}, 0),
-        Attributes("workclass", "categorical", {"Federal-gov", "Local-gov", "Never-worked", "Private", "Self-emp-inc", "Self-emp-not-inc", "State-gov", "Without-pay"}, 1),
-        Attributes("workclass_code", "numerical", {}, 2),
-        Attributes("education", "categorical", {"10th", "11th", "12th", "1st-4th", "5th-6th", "7th-8th", "9th", "Assoc-acdm", "Assoc-voc", "Bachelors", "Doctorate", "HS-grad", "Masters", "Preschool", "Prof-school", "Some-college"}, 3),
-        Attributes("education_num", "numerical", {}, 4),
-        Attributes("marital-status", "categorical", {"Divorced", "Married-AF-spouse", "Married-civ-spouse", "Married-spouse-absent", "Never-married", "Separated", "Widowed"}, 5),
-        Attributes("occupation", "categorical", {"Adm-clerical", "Armed-Forces", "Craft-repair", "Exec-managerial", "Farming-fishing", "Handlers-cleaners", "Machine-op-inspct", "Other-service", "Priv-house-serv", "Prof-specialty", "Protective-serv", "Sales", "Tech-support", "Transport-moving"}, 6),
-        Attributes("relationship", "categorical", {"Husband", "Not-in-family", "Other-relative", "Own-child", "Unmarried", "Wife"}, 7),
-        Attributes("race", "categorical", {"Amer-Indian-Eskimo", "Asian-Pac-Islander", "Black", "Other", "White"}, 8),
-        Attributes("sex", "categorical", {"Female", "Male"}, 9),
-        Attributes("capital-gain", "numerical", {}, 10),
-        Attributes("capital-loss", "numerical", {}, 11),
-        Attributes("hours-per-week", "numerical", {}, 12),
-        Attributes("native-country", "categorical", {"Cambodia", "Canada", "China", "Columbia", "Cuba", "Dominican-Republic", "Ecuador", "El-Salvador", "England", "France", "Germany", "Greece", "Guatemala", "Haiti", "Holand-Netherlands", "Honduras", "Hong", "Hungary", "India", "Iran", "Ireland", "Italy", "Jamaica", "Japan", "Laos", "Mexico", "Nicaragua", "Outlying-US(Guam-USVI-etc)", "Peru", "Philippines", "Poland", "Portugal", "Puerto-Rico", "Scotland", "South", "Taiwan", "Thailand", "Trinadad&Tobago", "United-States", "Vietnam", "Yugoslavia"}, 13),
-    };
-    dataset.attributes = attributes;
 
     cout << "Loading dataset..." << endl;
     
     auto load_start = chrono::high_resolution_clock::now();
-    loadIrisCSV("adult_imputed.data", dataset);
+    // No header line: name the fields; types and dictionaries are inferred.
+    // Later runs read the binary cache instead of the text.
+    CSVOptions csv;
+    csv.names = {"Age", "workclass", "workclass_code", "education", "education_num", "marital-status",
+                 "occupation", "relationship", "race", "sex", "capital-gain", "capital-loss",
+                 "hours-per-week", "native-country", "income"};
+    loadCSVCached("adult_imputed.data", "adult_imputed.bin", dataset, csv);
     auto load_end = chrono::high_resolution_clock::now();
     double loading_time = chrono::duration<double>(load_end - load_start).count();
-    cout << "Loaded " << dataset.rows.size() << " rows." << endl;
+    cout << "Loaded " << dataset.size() << " rows." << endl;
     //printDataset(dataset);
     cout << "Loading time: " << loading_time << " s" << endl << endl;
 
-    run(dataset);
+    run(dataset, threads);
+
+    // Optional second argument: bin count for the histogram-split drift report
+    if (argc > 2) {
+        runBinningDrift(dataset, threads, stoi(argv[2]));
+    }
+
+    // Optional third argument: accuracy tolerance (points) for the pruning report
+    if (argc > 3) {
+        runPruning(dataset, threads, stod(argv[3]));
+    }
 
 
     // cout << "Splitting train/test data..." << endl;
@@ -163,7 +203,7 @@ int main(int argc, char* argv[]) {
     // pair<Dataset, Dataset> split = trainTestSplitRandom(dataset, 0.8);
     // auto split_end = chrono::high_resolution_clock::now();
     // double split_time = chrono::duration<double>(split_end - split_start).count();
-    // cout << "Training set size: " << split.first.rows.size() << ", Test set size: " << split.second.rows.size() << endl;
+    // cout << "Training set size: " << split.first.size() << ", Test set size: " << split.second.size() << endl;
     // cout << "Split time: " << split_time << " s" << endl << endl;
 
    
@@ -171,7 +211,7 @@ int main(int argc, char* argv[]) {
 
     // cout << "Training decision tree..." << endl;
     // auto train_start = chrono::high_resolution_clock::now();
-    // DecisionTree dt(split.first, criterion, maxDepth);
+    // DecisionTree dt(split.first, criterion, maxDepth, threads);
     // auto train_end = chrono::high_resolution_clock::now();
     // double train_time = chrono::duration<double>(train_end - train_start).count();
     // cout << "Training completed." << endl;
@@ -181,8 +221,8 @@ int main(int argc, char* argv[]) {
     // cout << "Predicting test data..." << endl;
     // auto pred_start = chrono::high_resolution_clock::now();
     // int correctPredictions = 0;
-    // for (size_t i = 0; i < split.second.rows.size(); ++i) {
-    //     string predictedLabel = dt.predictLabel(split.second.rows[i]);
+    // for (size_t i = 0; i < split.second.size(); ++i) {
+    //     string predictedLabel = dt.predictLabel(split.second, i);
     //     if (predictedLabel == split.second.labels[i]) {
     //         correctPredictions++;
     //     }
@@ -190,7 +230,7 @@ int main(int argc, char* argv[]) {
     // auto pred_end = chrono::high_resolution_clock::now();
     // double prediction_time = chrono::duration<double>(pred_end - pred_start).count();
 
-    // double accuracy = static_cast<double>(correctPredictions) / split.second.rows.size() * 100.0;
+    // double accuracy = static_cast<double>(correctPredictions) / split.second.size() * 100.0;
     // cout << "Prediction completed." << endl;
     // cout << "Prediction time: " << prediction_time << " s" << endl << endl;
 
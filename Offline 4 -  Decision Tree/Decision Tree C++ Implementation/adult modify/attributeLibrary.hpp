@@ -8,15 +8,20 @@ class Attributes {
 public:
     string name;
     string type;
+    // For categorical attributes this is the dictionary: code i <-> uniqueValues[i]
     vector<string> uniqueValues;
     double threshold;
+    // Binary categorical split: bit c is set when code c goes to the first child
+    vector<uint64_t> leftCodes;
+    // Column of this attribute in the owning Dataset (stable after load)
     int index;
 
-    Attributes(string name, string type, vector<string> uniqueValues, int index)
+    Attributes(string name, string type, vector<string> uniqueValues, int index = -1)
         : name(name), type(type), uniqueValues(uniqueValues), threshold(0), index(index) {}
 
     Attributes(const Attributes& other)
-        : name(other.name), type(other.type), uniqueValues(other.uniqueValues), threshold(other.threshold), index(other.index) {}
+        : name(other.name), type(other.type), uniqueValues(other.uniqueValues), threshold(other.threshold),
+          leftCodes(other.leftCodes), index(other.index) {}
 
     Attributes() : threshold(0), index(0) {}
 
@@ -26,11 +31,16 @@ public:
             type = other.type;
             uniqueValues = other.uniqueValues;
             threshold = other.threshold;
+            leftCodes = other.leftCodes;
             index = other.index;
         }
         return *this;
     }
 
+    bool isNumerical() const {
+        return type == "numerical";
+    }
+
     bool operator==(const Attributes& other) const {
         return name == other.name && type == other.type;
     }
@@ -54,4 +64,4 @@ inline ostream& operator<<(ostream& os, const Attributes& attr) {
     return os;
 }
 
-#endif // ATTRIBUTE_LIBRARY_HPP
\ No newline at end of file
+#endif // ATTRIBUTE_LIBRARY_HPP
@@ -0,0 +1,285 @@
+#include "attributeLibrary.hpp"
+#include "datasetLibrary.hpp"
+#include "selectionCriteriaLibrary.hpp"
+#include "DTLibrary.hpp"
+#include "pruningLibrary.hpp"
+#include "modelLibrary.hpp"
+#include "syntheticLibrary.hpp"
+
+#include <bits/stdc++.h>
+using namespace std;
+
+// Micro-benchmarks of the library's hot paths, stage by stage.
+//
+//   benchmark [runs] [scale] [adult file] [iris file] [synthetic rows]
+//
+// Every stage runs once untimed (warm-up), then `runs` timed times (default
+// 5); the table shows the median, min, mean and standard deviation in ms,
+// and rows/s at the median. `scale` (default 8) sets the size of the scaled
+// data set: Adult with every row repeated that many times. `synthetic rows`
+// adds a generated data set of that size (see generateSynthetic; default
+// mix, seed 318).
+
+int warmupRuns = 1;
+int timedRuns = 5;
+
+// Results of a stage are added here so the compiler cannot drop the work
+volatile double benchmarkSink = 0;
+
+template <class Stage>
+void measure(const string &name, size_t rows, Stage stage) {
+    for (int i = 0; i < warmupRuns; ++i) {
+        benchmarkSink = benchmarkSink + stage();
+    }
+    vector<double> times;
+    for (int i = 0; i < timedRuns; ++i) {
+        auto start = chrono::high_resolution_clock::now();
+        benchmarkSink = benchmarkSink + stage();
+        auto end = chrono::high_resolution_clock::now();
+        times.push_back(chrono::duration<double, milli>(end - start).count());
+    }
+    sort(times.begin(), times.end());
+    double median = times[times.size() / 2];
+    double mean = accumulate(times.begin(), times.end(), 0.0) / times.size();
+    double variance = 0.0;
+    for (double time : times) variance += (time - mean) * (time - mean);
+    double deviation = sqrt(variance / times.size());
+
+    cout << left << setw(50) << name << right << setw(11) << rows << fixed << setprecision(3) << setw(12) << median
+         << setw(12) << times.front() << setw(12) << mean << setw(10) << deviation << setprecision(2) << setw(12)
+         << rows / median / 1000.0 << endl;
+}
+
+void printHeader() {
+    cout << left << setw(50) << "stage" << right << setw(11) << "rows" << setw(12) << "median ms" << setw(12)
+         << "min ms" << setw(12) << "mean ms" << setw(10) << "sd ms" << setw(12) << "Mrows/s" << endl;
+}
+
+// Stages of one data set. The build and predict stages use IG.
+void benchmarkDataset(const string &label, Dataset &data) {
+    size_t rows = data.size();
+    cout << endl << "== " << label << ": " << rows << " rows, " << data.attributes.size() << " attributes" << endl;
+    printHeader();
+
+    data.quantize(255);
+    vector<size_t> rowIndices(rows);
+    iota(rowIndices.begin(), rowIndices.end(), 0);
+    DatasetView view(data, rowIndices);
+    DatasetView binnedView = view;
+    binnedView.useHistograms = true;
+
+    measure("entropy (class counts + entropy)", rows, [&] {
+        vector<uint32_t> counts = view.classCounts();
+        return entropy(counts, rows);
+    });
+
+    // One attribute of each type: the first in schema order
+    vector<const Attributes *> samples;
+    for (string type : {"numerical", "categorical"}) {
+        for (const auto &attr : data.attributes) {
+            if (attr.type == type) {
+                samples.push_back(&attr);
+                break;
+            }
+        }
+    }
+    const char *criterionNames[] = {"IG", "IGR", "NWIG"};
+    for (const Attributes *attr : samples) {
+        string suffix = " " + attr->type + " (" + attr->name + ")";
+        for (int criterion = 0; criterion < CRITERIA_COUNT; ++criterion) {
+            measure(criterionNames[criterion] + suffix, rows, [&] {
+                double threshold;
+                return attributeScore(view, *attr, criterion, threshold);
+            });
+        }
+        measure("all criteria, one pass" + suffix, rows, [&] {
+            return scoreAttribute(view, *attr).score[InformationGain];
+        });
+        if (attr->isNumerical()) {
+            measure("IG binned" + suffix, rows, [&] {
+                double threshold;
+                return attributeScore(binnedView, *attr, InformationGain, threshold);
+            });
+        }
+    }
+
+    // The root split of a build; every run starts again from the rows in
+    // file order
+    for (const Attributes *attr : samples) {
+        string suffix = " " + attr->type + " (" + attr->name + ")";
+        if (attr->isNumerical()) {
+            Attributes split = *attr;
+            attributeScore(view, split, InformationGain, split.threshold);
+            measure("partition" + suffix, rows, [&] {
+                iota(rowIndices.begin(), rowIndices.end(), 0);
+                return (double)partitionByNumerical(view, split, split.threshold).first.size();
+            });
+        } else {
+            measure("partition" + suffix, rows, [&] {
+                iota(rowIndices.begin(), rowIndices.end(), 0);
+                return (double)partitionByCategorical(view, *attr).size();
+            });
+        }
+    }
+
+    for (int depth : {2, 4, 8, INT_MAX}) {
+        string name = "build, maxDepth " + (depth == INT_MAX ? string("unlimited") : to_string(depth));
+        measure(name, rows, [&] {
+            DecisionTree tree(data, InformationGain, depth);
+            return (double)tree.getSize();
+        });
+    }
+    TreeOptions binned;
+    binned.histogramSplits = true;
+    measure("build, unlimited, histogram 255 bins", rows, [&] {
+        DecisionTree tree(data, InformationGain, binned);
+        return (double)tree.getSize();
+    });
+    TreeOptions binary;
+    binary.binaryCategoricalSplits = true;
+    measure("build, unlimited, binary categorical", rows, [&] {
+        DecisionTree tree(data, InformationGain, binary);
+        return (double)tree.getSize();
+    });
+    vector<SelectionCriteria> criteria = {InformationGain, InformationGainRatio, NormalizedWeightedInformationGain};
+    measure("build, unlimited, IG+IGR+NWIG one by one", rows, [&] {
+        double size = 0;
+        for (SelectionCriteria criterion : criteria) size += DecisionTree(data, criterion).getSize();
+        return size;
+    });
+    measure("build, unlimited, IG+IGR+NWIG together", rows, [&] {
+        return (double)DecisionTree::growTogether(data, criteria, TreeOptions()).size();
+    });
+
+    DecisionTree tree(data, InformationGain);
+    measure("predictLabel (strings)", rows, [&] {
+        size_t length = 0;
+        for (size_t row = 0; row < rows; ++row) length += tree.predictLabel(data, row).size();
+        return (double)length;
+    });
+    measure("predictClass", rows, [&] {
+        long sum = 0;
+        for (size_t row = 0; row < rows; ++row) sum += tree.predictClass(data, row);
+        return (double)sum;
+    });
+    // Online scoring from text, as rows arrive one by one: the rows are
+    // written out as ", "-separated fields once, untimed
+    size_t textRows = min<size_t>(rows, 1 << 20);
+    vector<vector<string>> texts(textRows);
+    char number[32];
+    for (size_t row = 0; row < textRows; ++row) {
+        for (const auto &attr : data.attributes) {
+            if (attr.isNumerical()) {
+                double value = data.numericalColumns[attr.index][row];
+                texts[row].push_back(" " + (isnan(value) ? string("?")
+                                            : string(number, to_chars(number, number + sizeof(number), value).ptr)));
+            } else {
+                texts[row].push_back(" " + attr.uniqueValues[data.categoricalColumns[attr.index][row]]);
+            }
+        }
+    }
+    measure("encodeRow + predictClass (FeatureRow)", textRows, [&] {
+        long sum = 0;
+        for (size_t row = 0; row < textRows; ++row) sum += tree.predictClass(tree.encodeRow(texts[row]));
+        return (double)sum;
+    });
+    texts = vector<vector<string>>();
+
+    int threads = max(1u, thread::hardware_concurrency());
+    vector<int> classes;
+    measure("predictBatch, 1 thread", rows, [&] {
+        tree.predictBatch(data, classes, 1);
+        return (double)classes[rows / 2];
+    });
+    measure("predictBatch, " + to_string(threads) + " threads", rows, [&] {
+        tree.predictBatch(data, classes, threads);
+        return (double)classes[rows / 2];
+    });
+    if (threads > 1) {
+        // A pool kept across calls, as a server scoring many batches would
+        ThreadPool pool(threads - 1);
+        measure("predictBatch, " + to_string(threads) + " threads, reused pool", rows, [&] {
+            tree.predictBatch(data, classes, pool);
+            return (double)classes[rows / 2];
+        });
+    }
+    vector<float> probabilities;
+    measure("predictBatch probabilities, 1 thread", rows, [&] {
+        tree.predictBatch(data, probabilities, 1);
+        return (double)probabilities[0];
+    });
+
+    // Model file round trip; loading maps the file and checks the nodes
+    string modelFile = "benchmark.model";
+    measure("save model", rows, [&] {
+        return (double)saveModel(tree, modelFile);
+    });
+    measure("load model (mmap)", rows, [&] {
+        TreeModel model;
+        loadModel(modelFile, model);
+        return (double)model.getSize();
+    });
+    remove(modelFile.c_str());
+
+    // Pruning the unlimited tree, validated on the training rows
+    measure("cost-complexity path + accuracies", rows, [&] {
+        PruningPath path = costComplexityPath(tree);
+        return pathAccuracies(tree, path, data).back();
+    });
+    measure("reduced-error pruning", rows, [&] {
+        DecisionTree pruned = tree;
+        pruneReducedError(pruned, data);
+        return (double)pruned.getSize();
+    });
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc > 1) timedRuns = max(1, stoi(argv[1]));
+    int scale = (argc > 2) ? max(1, stoi(argv[2])) : 8;
+    string adultFile = (argc > 3) ? argv[3] : "adult_imputed.data";
+    string irisFile = (argc > 4) ? argv[4] : "../iris-dataset-train/Iris.csv";
+    size_t syntheticRows = (argc > 5) ? stoull(argv[5]) : 0;
+
+    CSVOptions irisCSV;
+    irisCSV.hasHeader = true;
+    irisCSV.exclude = {"Id"};
+    CSVOptions adultCSV;
+    adultCSV.names = {"Age", "workclass", "workclass_code", "education", "education_num", "marital-status",
+                      "occupation", "relationship", "race", "sex", "capital-gain", "capital-loss",
+                      "hours-per-week", "native-country", "income"};
+    Dataset iris, adult;
+    iris.name = "Iris Dataset";
+    adult.name = "Adult Dataset";
+    if (!loadCSV(irisFile, iris, irisCSV) || !loadCSV(adultFile, adult, adultCSV)) {
+        cout << "Could not read " << irisFile << " or " << adultFile << endl;
+        return 1;
+    }
+
+    cout << "== Loading" << endl;
+    printHeader();
+    measure("load Iris (CSV)", iris.size(), [&] {
+        Dataset loaded;
+        return (double)loadCSV(irisFile, loaded, irisCSV);
+    });
+    measure("load Adult (CSV)", adult.size(), [&] {
+        Dataset loaded;
+        return (double)loadCSV(adultFile, loaded, adultCSV);
+    });
+
+    vector<size_t> repeated(adult.size() * scale);
+    for (size_t i = 0; i < repeated.size(); ++i) repeated[i] = i % adult.size();
+    Dataset scaled = adult.subset(repeated);
+
+    benchmarkDataset("Iris", iris);
+    benchmarkDataset("Adult", adult);
+    benchmarkDataset("Adult x" + to_string(scale), scaled);
+    if (syntheticRows > 0) {
+        SyntheticOptions options;
+        options.rows = syntheticRows;
+        Dataset synthetic;
+        generateSynthetic(options, synthetic);
+        benchmarkDataset("Synthetic", synthetic);
+    }
+    return 0;
+}
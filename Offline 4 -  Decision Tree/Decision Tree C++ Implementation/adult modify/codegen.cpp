@@ -0,0 +1,54 @@
+#include "attributeLibrary.hpp"
+#include "DTLibrary.hpp"
+#include "modelLibrary.hpp"
+#include "codegenLibrary.hpp"
+
+#include <bits/stdc++.h>
+using namespace std;
+
+// Turns a saved model (see saveModel) into a self-contained C++ header (see
+// exportCpp).
+//
+//   codegen <model file> <output.hpp> [name=model] [depthCap=N] [maxBranchNodes=N]
+//
+// depthCap exports the tree cut at that depth; trees with more than
+// maxBranchNodes nodes (default 4096) get a node table instead of branches.
+int main(int argc, char* argv[])
+{
+    if (argc < 3) {
+        cout << "usage: codegen <model file> <output.hpp> [name=model] [depthCap=N] [maxBranchNodes=N]" << endl;
+        return 1;
+    }
+    string modelFile = argv[1];
+    string output = argv[2];
+    CodegenOptions options;
+    for (int i = 3; i < argc; ++i) {
+        string argument = argv[i];
+        size_t equals = argument.find('=');
+        string key = argument.substr(0, equals);
+        string value = equals == string::npos ? "" : argument.substr(equals + 1);
+        try {
+            if (key == "name") options.name = value;
+            else if (key == "depthCap") options.depthCap = stoi(value);
+            else if (key == "maxBranchNodes") options.maxBranchNodes = stoull(value);
+            else throw invalid_argument(key);
+        } catch (const exception &) {
+            cout << "Invalid argument: " << argument << endl;
+            return 1;
+        }
+    }
+
+    TreeModel model;
+    if (!loadModel(modelFile, model)) {
+        cout << "Could not read model " << modelFile << endl;
+        return 1;
+    }
+    if (!exportCpp(model, output, options)) {
+        cout << "Could not write " << output << endl;
+        return 1;
+    }
+    size_t nodes = model.getSize(options.depthCap);
+    cout << "Wrote " << output << ": " << nodes << " nodes, depth " << model.getDepth(options.depthCap) << ", "
+         << (nodes <= options.maxBranchNodes ? "one branch per node" : "node table") << endl;
+    return 0;
+}
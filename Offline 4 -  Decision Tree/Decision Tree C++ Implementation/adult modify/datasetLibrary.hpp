@@ -5,130 +5,1011 @@
 #include <bits/stdc++.h>
 using namespace std;
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Bin code of a missing (NaN) value in a quantized column
+const uint8_t MISSING_BIN = 255;
+
+// Bin count that quantize actually uses for a request of maxBins: 2..255,
+// so that bin codes fit in a byte next to MISSING_BIN
+int clampedBins(int maxBins) {
+    return max(2, min(maxBins, 255));
+}
+
+// `text` without surrounding whitespace
+string_view trim(string_view text) {
+    while (!text.empty() && isspace((unsigned char)text.front())) text.remove_prefix(1);
+    while (!text.empty() && isspace((unsigned char)text.back())) text.remove_suffix(1);
+    return text;
+}
+
+// Class of the largest count; ties go to the alphabetically first class name
+int majorityClass(const vector<uint32_t> &counts, const vector<string> &classNames) {
+    int best = -1;
+    for (size_t c = 0; c < counts.size(); ++c) {
+        if (counts[c] == 0) continue;
+        if (best < 0 || counts[c] > counts[best] ||
+            (counts[c] == counts[best] && classNames[c] < classNames[best])) {
+            best = c;
+        }
+    }
+    return best;
+}
+
+// Column-oriented dataset. Every value is parsed exactly once, when the row is
+// added: numerical columns hold doubles, categorical columns hold dictionary
+// codes into Attributes::uniqueValues. Columns are addressed by
+// Attributes::index, which stays the same in every subset of the dataset.
+// Labels are encoded the same way: labels[row] is a class id into classNames.
+// Categories and labels are trimmed of surrounding whitespace first (so
+// "a, b" reads as "a" and "b"), as encodeFeatures trims them when scoring.
 class Dataset {
 public:
     string name;
     vector<Attributes> attributes;
-    vector<vector<string>> rows;
-    vector<string> labels;
+    vector<vector<double>> numericalColumns;
+    vector<vector<int>> categoricalColumns;
+    vector<unordered_map<string, int>> dictionaries;
+    vector<string> classNames;
+    unordered_map<string, int> classIds;
+    vector<int> labels;
 
-    Dataset(string name, vector<Attributes> &attributes, vector<vector<string>> &rows, vector<string> &labels) 
-        : name(name), attributes(attributes), rows(rows), labels(labels) {
+    // Histogram mode (see quantize): per numerical column, the bin of every
+    // row and the thresholds between neighbouring bins
+    int maxBins;
+    vector<vector<uint8_t>> binnedColumns;
+    vector<vector<double>> binThresholds;
+
+    Dataset(string name, vector<Attributes> &attributes)
+        : name(name), maxBins(0) {
+        setAttributes(attributes);
+    }
+    Dataset() : maxBins(0) {}
+
+    void setAttributes(const vector<Attributes> &newAttributes) {
+        attributes = newAttributes;
+        numericalColumns.assign(attributes.size(), vector<double>());
+        categoricalColumns.assign(attributes.size(), vector<int>());
+        dictionaries.assign(attributes.size(), unordered_map<string, int>());
         for (size_t i = 0; i < attributes.size(); ++i) {
-            this->attributes[i].index = i;
-        }
-    }
-    Dataset() {}
-    
-    string getMajorityLabel() {
-        unordered_map<string, int> labelCount;
-        for (const auto& label : labels) {
-            labelCount[label]++;
-        }
-        string majorityLabel;
-        int maxCount = 0;
-        for (const auto& pair : labelCount) {
-            if (pair.second > maxCount) {
-                maxCount = pair.second;
-                majorityLabel = pair.first;
+            attributes[i].index = i;
+            for (size_t code = 0; code < attributes[i].uniqueValues.size(); ++code) {
+                dictionaries[i][attributes[i].uniqueValues[code]] = code;
+            }
+        }
+    }
+
+    size_t size() const {
+        return labels.size();
+    }
+
+    // Dictionary code of a categorical value; unseen values extend the dictionary
+    int encode(int column, const string &value) {
+        auto it = dictionaries[column].find(value);
+        if (it != dictionaries[column].end()) {
+            return it->second;
+        }
+        int code = attributes[column].uniqueValues.size();
+        attributes[column].uniqueValues.push_back(value);
+        dictionaries[column][value] = code;
+        return code;
+    }
+
+    // values[i] is the raw text of attributes[i]
+    void addRow(const vector<string> &values, const string &label) {
+        for (size_t i = 0; i < attributes.size(); ++i) {
+            int column = attributes[i].index;
+            if (attributes[i].isNumerical()) {
+                char *end;
+                double value = strtod(values[i].c_str(), &end);
+                if (end == values[i].c_str()) value = numeric_limits<double>::quiet_NaN();
+                numericalColumns[column].push_back(value);
+            } else {
+                categoricalColumns[column].push_back(encode(column, string(trim(values[i]))));
+            }
+        }
+        labels.push_back(encodeClass(string(trim(label))));
+    }
+
+    // Class id of a label; unseen labels get the next id
+    int encodeClass(const string &label) {
+        auto it = classIds.find(label);
+        if (it != classIds.end()) {
+            return it->second;
+        }
+        int id = classNames.size();
+        classNames.push_back(label);
+        classIds[label] = id;
+        return id;
+    }
+
+    int classCount() const {
+        return classNames.size();
+    }
+
+    // Renumbers a categorical column so that its dictionary is in
+    // alphabetical order
+    void sortDictionary(int column) {
+        vector<string> &values = attributes[column].uniqueValues;
+        vector<int> order(values.size());
+        iota(order.begin(), order.end(), 0);
+        sort(order.begin(), order.end(), [&](int a, int b) { return values[a] < values[b]; });
+        vector<int> newCode(values.size());
+        vector<string> sorted;
+        for (size_t code = 0; code < order.size(); ++code) {
+            newCode[order[code]] = code;
+            sorted.push_back(values[order[code]]);
+        }
+        values = sorted;
+        dictionaries[column].clear();
+        for (size_t code = 0; code < values.size(); ++code) {
+            dictionaries[column][values[code]] = code;
+        }
+        for (int &code : categoricalColumns[column]) {
+            code = newCode[code];
+        }
+    }
+
+    const string &labelName(size_t row) const {
+        return classNames[labels[row]];
+    }
+
+    // Copy of the given rows, keeping only the columns of the current attributes
+    Dataset subset(const vector<size_t> &rowIndices) const {
+        Dataset result;
+        result.name = name;
+        result.attributes = attributes;
+        result.dictionaries = dictionaries;
+        result.numericalColumns.assign(numericalColumns.size(), vector<double>());
+        result.categoricalColumns.assign(categoricalColumns.size(), vector<int>());
+        for (const auto &attr : attributes) {
+            if (attr.isNumerical()) {
+                const vector<double> &source = numericalColumns[attr.index];
+                vector<double> &column = result.numericalColumns[attr.index];
+                column.reserve(rowIndices.size());
+                for (size_t row : rowIndices) column.push_back(source[row]);
+            } else {
+                const vector<int> &source = categoricalColumns[attr.index];
+                vector<int> &column = result.categoricalColumns[attr.index];
+                column.reserve(rowIndices.size());
+                for (size_t row : rowIndices) column.push_back(source[row]);
             }
         }
-        return majorityLabel;
+        result.classNames = classNames;
+        result.classIds = classIds;
+        result.labels.reserve(rowIndices.size());
+        for (size_t row : rowIndices) result.labels.push_back(labels[row]);
+
+        result.maxBins = maxBins;
+        result.binThresholds = binThresholds;
+        result.binnedColumns.assign(binnedColumns.size(), vector<uint8_t>());
+        for (size_t c = 0; c < binnedColumns.size(); ++c) {
+            if (binnedColumns[c].empty()) continue;
+            result.binnedColumns[c].reserve(rowIndices.size());
+            for (size_t row : rowIndices) result.binnedColumns[c].push_back(binnedColumns[c][row]);
+        }
+        return result;
+    }
+
+    bool isQuantized() const {
+        return maxBins > 0;
+    }
+
+    // Quantizes every numerical column into at most maxBins quantile bins
+    // (see clampedBins). Thresholds sit halfway between the largest value of a
+    // bin and the smallest value of the next one, so a column with few
+    // distinct values keeps exactly the thresholds of the exact search.
+    void quantize(int maxBins = 255) {
+        maxBins = clampedBins(maxBins);
+        this->maxBins = maxBins;
+        binnedColumns.assign(attributes.size(), vector<uint8_t>());
+        binThresholds.assign(attributes.size(), vector<double>());
+        for (const auto &attr : attributes) {
+            if (!attr.isNumerical()) continue;
+            const vector<double> &column = numericalColumns[attr.index];
+
+            vector<double> sorted;
+            sorted.reserve(column.size());
+            for (double value : column) {
+                if (!isnan(value)) sorted.push_back(value);
+            }
+            sort(sorted.begin(), sorted.end());
+
+            vector<double> &thresholds = binThresholds[attr.index];
+            size_t n = sorted.size();
+            size_t distinct = n > 0 ? 1 : 0;
+            for (size_t i = 0; i + 1 < n; ++i) {
+                if (sorted[i] != sorted[i + 1]) distinct++;
+            }
+            size_t binsClosed = 0;
+            for (size_t i = 0; i + 1 < n; ++i) {
+                if (sorted[i] == sorted[i + 1]) continue;
+                // Close the current bin once it holds its share of the rows
+                if (distinct <= (size_t)maxBins || (i + 1) * maxBins >= (binsClosed + 1) * n) {
+                    thresholds.push_back((sorted[i] + sorted[i + 1]) / 2.0);
+                    binsClosed++;
+                }
+            }
+
+            vector<uint8_t> &bins = binnedColumns[attr.index];
+            bins.reserve(column.size());
+            for (double value : column) {
+                if (isnan(value)) {
+                    bins.push_back(MISSING_BIN);
+                } else {
+                    bins.push_back(lower_bound(thresholds.begin(), thresholds.end(), value) - thresholds.begin());
+                }
+            }
+        }
+    }
+
+    vector<uint32_t> classCounts() const {
+        vector<uint32_t> counts(classCount(), 0);
+        for (int label : labels) {
+            counts[label]++;
+        }
+        return counts;
+    }
+
+    int getMajorityClass() const {
+        return majorityClass(classCounts(), classNames);
     }
 };
 
-pair<Dataset, Dataset> trainTestSplitRandom(Dataset &dataset, double trainSize) {
-    vector<vector<string>> trainRows;
-    vector<vector<string>> testRows;
-    vector<string> trainLabels;
-    vector<string> testLabels;
+// Same seed, same split
+pair<Dataset, Dataset> trainTestSplitRandom(const Dataset &dataset, double trainSize, uint64_t seed) {
+    mt19937_64 g(seed);
 
-    random_device rd;
-    mt19937 g(rd());
-    
     // Create indices for shuffling
-    vector<size_t> indices(dataset.rows.size());
+    vector<size_t> indices(dataset.size());
     iota(indices.begin(), indices.end(), 0);
     shuffle(indices.begin(), indices.end(), g);
 
-    size_t trainCount = static_cast<size_t>(dataset.rows.size() * trainSize);
-    
-    for (size_t i = 0; i < dataset.rows.size(); ++i) {
-        if (i < trainCount) {
-            trainRows.push_back(dataset.rows[indices[i]]);
-            trainLabels.push_back(dataset.labels[indices[i]]);
-        } else {
-            testRows.push_back(dataset.rows[indices[i]]);
-            testLabels.push_back(dataset.labels[indices[i]]);
+    size_t trainCount = static_cast<size_t>(dataset.size() * trainSize);
+    vector<size_t> trainRows(indices.begin(), indices.begin() + trainCount);
+    vector<size_t> testRows(indices.begin() + trainCount, indices.end());
+
+    return make_pair(dataset.subset(trainRows), dataset.subset(testRows));
+}
+
+pair<Dataset, Dataset> trainTestSplitRandom(const Dataset &dataset, double trainSize) {
+    random_device rd;
+    return trainTestSplitRandom(dataset, trainSize, (uint64_t)rd() << 32 | rd());
+}
+
+// Read-only view of a whole file: memory-mapped where mmap exists, read in
+// one go elsewhere
+class MappedFile {
+public:
+    const char *data;
+    size_t size;
+
+    explicit MappedFile(const string &filename) : data(nullptr), size(0), mapping(nullptr) {
+#ifndef _WIN32
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat info;
+        if (fstat(fd, &info) == 0 && info.st_size > 0) {
+            void *address = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (address != MAP_FAILED) {
+                madvise(address, info.st_size, MADV_SEQUENTIAL);
+                mapping = address;
+                data = static_cast<const char *>(address);
+                size = info.st_size;
+            }
         }
+        close(fd);
+#else
+        ifstream file(filename, ios::binary);
+        if (!file) return;
+        buffer.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+        data = buffer.data();
+        size = buffer.size();
+#endif
+    }
+
+    ~MappedFile() {
+#ifndef _WIN32
+        if (mapping) munmap(mapping, size);
+#endif
     }
-    return make_pair(
-        Dataset(dataset.name, dataset.attributes, trainRows, trainLabels),
-        Dataset(dataset.name, dataset.attributes, testRows, testLabels)
-    );
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+private:
+    void *mapping;
+    string buffer;
+};
+
+// How loadCSV maps the fields of a line onto the dataset's attributes
+class CSVOptions {
+public:
+    // The first line holds the column names (and is not a row)
+    bool hasHeader;
+    // Column names for files without a header; missing ones become "column<i>"
+    vector<string> names;
+    // Schema inference only: keep just these columns (empty keeps all) and
+    // drop these, by name
+    vector<string> include;
+    vector<string> exclude;
+    // Preset schema only: columns[i] is the field of attributes[i]; empty
+    // means field i
+    vector<int> columns;
+    // Field holding the label; -1 means the last field of the line
+    int labelColumn;
+    char delimiter;
+    // Schema inference only: tokens that mean "no value". They do not make a
+    // column categorical and read as NaN in numerical columns.
+    vector<string> missingValues;
+    // Parsing threads; 0 means one per core
+    int threads;
+
+    CSVOptions() : hasHeader(false), labelColumn(-1), delimiter(','), missingValues({"", "?", "NA"}), threads(0) {}
+};
+
+// Text of a number -> value, NaN if it does not start with one (like addRow's
+// strtod). Returns whether the whole text, bar surrounding spaces, is a number.
+bool parseNumber(string_view text, double &value) {
+    text = trim(text);
+    if (!text.empty() && text.front() == '+') text.remove_prefix(1);
+    auto result = from_chars(text.data(), text.data() + text.size(), value);
+    if (result.ec != errc()) {
+        value = numeric_limits<double>::quiet_NaN();
+        return false;
+    }
+    return result.ptr == text.data() + text.size();
 }
 
-Dataset filterByCategorical(const Dataset& dataset, const Attributes& attr, const string& value) {
-    vector<Attributes> newAttributes;
-    size_t attrIndex = attr.index; 
-    for (const auto& a : dataset.attributes) {
-        if (a.name != attr.name) {
-            newAttributes.push_back(a);
+// Splits one line (without its newline) into `fields`
+void splitFields(const char *line, const char *lineEnd, char delimiter, vector<string_view> &fields) {
+    fields.clear();
+    const char *field = line;
+    for (const char *c = line; c <= lineEnd; ++c) {
+        if (c == lineEnd || *c == delimiter) {
+            fields.emplace_back(field, c - field);
+            field = c + 1;
         }
     }
-    
-    vector<vector<string>> newRows;
-    vector<string> newLabels;
+}
+
+// End of the line starting at `line`, without the newline and a trailing '\r'
+const char *lineEndOf(const char *line, const char *end) {
+    const char *lineEnd = static_cast<const char *>(memchr(line, '\n', end - line));
+    if (!lineEnd) lineEnd = end;
+    if (lineEnd > line && lineEnd[-1] == '\r') lineEnd--;
+    return lineEnd;
+}
+
+// Rows of one newline-aligned slice of the file. Categorical values and
+// labels get chunk-local codes in order of first appearance; merging the
+// chunks in file order then assigns exactly the codes a serial load would.
+//
+// With schema inference every column starts out numerical. The first token
+// that is neither a number nor a missing value turns the column categorical,
+// and its earlier rows are re-read from the remembered line starts.
+class CSVChunk {
+public:
+    vector<bool> numeric;
+    vector<vector<double>> numerical;
+    vector<vector<int>> categorical;
+    vector<vector<string_view>> values;
+    vector<int> labels;
+    vector<string_view> classNames;
 
-    for (size_t i = 0; i < dataset.rows.size(); ++i) {
-        if (dataset.rows[i][attrIndex] == value) {
-            vector<string> newRow;
-            for (size_t j = 0; j < dataset.rows[i].size(); ++j) {
-                if (j != attrIndex) {
-                    newRow.push_back(dataset.rows[i][j]);
+    void parse(const char *begin, const char *end, const vector<int> &columns, const vector<bool> &columnIsNumeric,
+               bool inferTypes, const CSVOptions &options) {
+        this->end = end;
+        this->columns = &columns;
+        this->options = &options;
+        size_t attributeCount = columns.size();
+        numeric = columnIsNumeric;
+        numerical.assign(attributeCount, vector<double>());
+        categorical.assign(attributeCount, vector<int>());
+        values.assign(attributeCount, vector<string_view>());
+        codes.assign(attributeCount, unordered_map<string_view, int>());
+        unordered_map<string_view, int> classCodes;
+
+        // Fields a line needs; the label defaults to a field after all attributes
+        int lastColumn = -1;
+        for (int column : columns) lastColumn = max(lastColumn, column);
+        int needed = options.labelColumn < 0 ? lastColumn + 2 : max(lastColumn, options.labelColumn) + 1;
+
+        vector<string_view> fields;
+        const char *line = begin;
+        while (line < end) {
+            const char *lineEnd = lineEndOf(line, end);
+            const char *next = static_cast<const char *>(memchr(line, '\n', end - line));
+            next = next ? next + 1 : end;
+            splitFields(line, lineEnd, options.delimiter, fields);
+            // Skip blank and truncated lines
+            if (lineEnd == line || (int)fields.size() < needed) {
+                line = next;
+                continue;
+            }
+
+            size_t row = labels.size();
+            if (inferTypes) lineStarts.push_back(line);
+            for (size_t i = 0; i < attributeCount; ++i) {
+                string_view text = fields[columns[i]];
+                if (numeric[i]) {
+                    double value;
+                    if (parseNumber(text, value) || !inferTypes || isMissing(text)) {
+                        numerical[i].push_back(value);
+                        continue;
+                    }
+                    makeCategorical(i, row);
                 }
+                categorical[i].push_back(encode(i, text));
             }
-            newRows.push_back(newRow);
-            newLabels.push_back(dataset.labels[i]);
+            string_view label = trim(options.labelColumn < 0 ? fields.back() : fields[options.labelColumn]);
+            auto inserted = classCodes.emplace(label, classNames.size());
+            if (inserted.second) classNames.push_back(label);
+            labels.push_back(inserted.first->second);
+            line = next;
         }
     }
-    
-    for (size_t i = 0; i < newAttributes.size(); ++i) {
-        newAttributes[i].index = i;
+
+    // Re-reads the first `rows` rows of attribute i as categorical values
+    void makeCategorical(size_t i, size_t rows) {
+        numeric[i] = false;
+        numerical[i] = vector<double>();
+        vector<string_view> fields;
+        for (size_t row = 0; row < rows; ++row) {
+            splitFields(lineStarts[row], lineEndOf(lineStarts[row], end), options->delimiter, fields);
+            categorical[i].push_back(encode(i, fields[(*columns)[i]]));
+        }
     }
-    return Dataset(dataset.name, newAttributes, newRows, newLabels);
-}
 
-Dataset filterByNumerical(const Dataset& dataset, const Attributes& attr, double threshold, bool lessEqual) {
-    vector<Attributes> newAttributes;
-    size_t attrIndex = attr.index; 
-    for (const auto& a : dataset.attributes) {
-        if (a.name != attr.name) {
-            newAttributes.push_back(a);
+private:
+    const char *end;
+    const vector<int> *columns;
+    const CSVOptions *options;
+    vector<unordered_map<string_view, int>> codes;
+    vector<const char *> lineStarts;
+
+    int encode(size_t i, string_view text) {
+        text = trim(text);
+        auto inserted = codes[i].emplace(text, values[i].size());
+        if (inserted.second) values[i].push_back(text);
+        return inserted.first->second;
+    }
+
+    bool isMissing(string_view text) const {
+        text = trim(text);
+        for (const auto &missing : options->missingValues) {
+            if (text == missing) return true;
+        }
+        return false;
+    }
+};
+
+// Appends the rows of a delimited text file to `dataset`. The file is
+// memory-mapped, cut into newline-aligned chunks and the chunks are parsed
+// concurrently straight into columns.
+//
+// A dataset without attributes gets its schema from the file, in the same
+// pass: column names from the header (or options.names), column types from
+// the values (a column is numerical if every value is a number or missing)
+// and dictionaries sorted alphabetically. options.include/exclude pick the
+// columns. Otherwise the dataset's attributes say how to read each field.
+// Returns false if the file cannot be read.
+bool loadCSV(const string &filename, Dataset &dataset, const CSVOptions &options = CSVOptions()) {
+    MappedFile file(filename);
+    if (!file.data) return false;
+
+    const char *begin = file.data;
+    const char *end = file.data + file.size;
+    vector<string_view> header;
+    if (options.hasHeader) {
+        splitFields(begin, lineEndOf(begin, end), options.delimiter, header);
+        const char *newline = static_cast<const char *>(memchr(begin, '\n', end - begin));
+        begin = newline ? newline + 1 : end;
+    }
+
+    bool inferTypes = dataset.attributes.empty();
+    vector<int> columns;
+    vector<bool> columnIsNumeric;
+    if (inferTypes) {
+        vector<string_view> firstRow;
+        splitFields(begin, lineEndOf(begin, end), options.delimiter, firstRow);
+        int fieldCount = options.hasHeader ? header.size() : firstRow.size();
+        int labelColumn = options.labelColumn < 0 ? fieldCount - 1 : options.labelColumn;
+
+        vector<Attributes> attributes;
+        for (int column = 0; column < fieldCount; ++column) {
+            string name = options.hasHeader ? string(trim(header[column]))
+                        : column < (int)options.names.size() ? options.names[column]
+                        : "column" + to_string(column);
+            bool included = options.include.empty() ||
+                            find(options.include.begin(), options.include.end(), name) != options.include.end();
+            bool excluded = find(options.exclude.begin(), options.exclude.end(), name) != options.exclude.end();
+            if (column == labelColumn || !included || excluded) continue;
+            attributes.push_back(Attributes(name, "numerical", {}));
+            columns.push_back(column);
         }
+        dataset.setAttributes(attributes);
+        columnIsNumeric.assign(columns.size(), true);
+    } else {
+        columns = options.columns;
+        for (size_t i = columns.size(); i < dataset.attributes.size(); ++i) {
+            columns.push_back(i);
+        }
+        for (const auto &attr : dataset.attributes) {
+            columnIsNumeric.push_back(attr.isNumerical());
+        }
+    }
+
+    // Chunks of at least 1 MiB, so small files are not worth a thread
+    size_t threads = options.threads > 0 ? options.threads : max(1u, thread::hardware_concurrency());
+    size_t chunkCount = max<size_t>(1, min<size_t>(threads, (end - begin) >> 20));
+    vector<const char *> bounds = {begin};
+    for (size_t k = 1; k < chunkCount; ++k) {
+        const char *cut = begin + (end - begin) * k / chunkCount;
+        cut = max(cut, bounds.back());
+        const char *newline = static_cast<const char *>(memchr(cut, '\n', end - cut));
+        bounds.push_back(newline ? newline + 1 : end);
+    }
+    bounds.push_back(end);
+
+    vector<CSVChunk> chunks(chunkCount);
+    vector<thread> workers;
+    for (size_t k = 1; k < chunkCount; ++k) {
+        workers.emplace_back([&, k] {
+            chunks[k].parse(bounds[k], bounds[k + 1], columns, columnIsNumeric, inferTypes, options);
+        });
+    }
+    chunks[0].parse(bounds[0], bounds[1], columns, columnIsNumeric, inferTypes, options);
+    for (auto &worker : workers) {
+        worker.join();
     }
-    
-    vector<vector<string>> newRows;
-    vector<string> newLabels;
 
-    for (size_t i = 0; i < dataset.rows.size(); ++i) {
-        double val = stod(dataset.rows[i][attrIndex]);
-        if ((lessEqual && val <= threshold) || (!lessEqual && val > threshold)) {
-            vector<string> newRow;
-            for (size_t j = 0; j < dataset.rows[i].size(); ++j) {
-                if (j != attrIndex) {
-                    newRow.push_back(dataset.rows[i][j]);
+    // A column is categorical as soon as one chunk found it to be
+    if (inferTypes) {
+        for (size_t i = 0; i < columns.size(); ++i) {
+            bool numeric = true;
+            for (const CSVChunk &chunk : chunks) numeric = numeric && chunk.numeric[i];
+            if (numeric) continue;
+            dataset.attributes[i].type = "categorical";
+            for (CSVChunk &chunk : chunks) {
+                if (chunk.numeric[i]) chunk.makeCategorical(i, chunk.labels.size());
+            }
+        }
+    }
+
+    for (CSVChunk &chunk : chunks) {
+        for (size_t i = 0; i < dataset.attributes.size(); ++i) {
+            int column = dataset.attributes[i].index;
+            if (dataset.attributes[i].isNumerical()) {
+                vector<double> &target = dataset.numericalColumns[column];
+                target.insert(target.end(), chunk.numerical[i].begin(), chunk.numerical[i].end());
+            } else {
+                vector<int> code(chunk.values[i].size());
+                for (size_t local = 0; local < code.size(); ++local) {
+                    code[local] = dataset.encode(column, string(chunk.values[i][local]));
                 }
+                vector<int> &target = dataset.categoricalColumns[column];
+                target.reserve(target.size() + chunk.categorical[i].size());
+                for (int local : chunk.categorical[i]) target.push_back(code[local]);
+            }
+        }
+        vector<int> classId(chunk.classNames.size());
+        for (size_t local = 0; local < classId.size(); ++local) {
+            classId[local] = dataset.encodeClass(string(chunk.classNames[local]));
+        }
+        dataset.labels.reserve(dataset.labels.size() + chunk.labels.size());
+        for (int local : chunk.labels) dataset.labels.push_back(classId[local]);
+    }
+
+    if (inferTypes) {
+        for (const auto &attr : dataset.attributes) {
+            if (!attr.isNumerical()) dataset.sortDictionary(attr.index);
+        }
+    }
+    return true;
+}
+
+// The header line of saveCSV: attribute names, then "class"
+string csvHeader(const Dataset &dataset, char delimiter = ',') {
+    string text;
+    for (const auto &attr : dataset.attributes) {
+        text += attr.name;
+        text += delimiter;
+    }
+    text += "class\n";
+    return text;
+}
+
+// Appends the rows of `dataset` to `file` as saveCSV writes them
+bool writeCSVRows(const Dataset &dataset, ostream &file, char delimiter = ',') {
+    string text;
+    char number[32];
+    for (size_t row = 0; row < dataset.size(); ++row) {
+        for (const auto &attr : dataset.attributes) {
+            if (attr.isNumerical()) {
+                double value = dataset.numericalColumns[attr.index][row];
+                if (isnan(value)) {
+                    text += '?';
+                } else {
+                    text.append(number, to_chars(number, number + sizeof(number), value).ptr);
+                }
+            } else {
+                text += attr.uniqueValues[dataset.categoricalColumns[attr.index][row]];
+            }
+            text += delimiter;
+        }
+        text += dataset.labelName(row);
+        text += '\n';
+        // Written in blocks, so the whole file never sits in memory
+        if (text.size() >= (1 << 20)) {
+            file.write(text.data(), text.size());
+            text.clear();
+        }
+    }
+    file.write(text.data(), text.size());
+    return bool(file);
+}
+
+// Writes `dataset` as CSV with a header line (see csvHeader), so loadCSV
+// with hasHeader reads it back. Numbers are written in their shortest exact
+// form and missing values as "?".
+bool saveCSV(const Dataset &dataset, const string &filename, char delimiter = ',') {
+    ofstream file(filename, ios::binary | ios::trunc);
+    if (!file) return false;
+    file << csvHeader(dataset, delimiter);
+    return writeCSVRows(dataset, file, delimiter);
+}
+
+// Binary dataset cache. Native byte order, in this order:
+//   header    "DTDS", uint32 version, uint64 rows, uint32 attributes, uint32 classes
+//   schema    dataset name, then per attribute: name, uint8 type (0 numerical,
+//             1 categorical), uint32 dictionary size, dictionary values
+//   classes   class names
+//   columns   per attribute rows doubles (numerical) or rows int32 codes
+//             (categorical), then rows int32 class ids for the labels
+// Strings are a uint32 length and the bytes; every column starts on an
+// 8-byte boundary.
+const char DATASET_MAGIC[4] = {'D', 'T', 'D', 'S'};
+const uint32_t DATASET_VERSION = 1;
+
+class BinaryWriter {
+public:
+    string bytes;
+
+    template <typename T>
+    void write(const T &value) {
+        bytes.append(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    void writeString(const string &text) {
+        write<uint32_t>(text.size());
+        bytes.append(text);
+    }
+
+    template <typename T>
+    void writeColumn(const vector<T> &column) {
+        bytes.append((8 - bytes.size() % 8) % 8, '\0');
+        bytes.append(reinterpret_cast<const char *>(column.data()), column.size() * sizeof(T));
+    }
+};
+
+// Bounds-checked reads from a mapped file; any overrun clears `ok`
+class BinaryReader {
+public:
+    const char *data;
+    size_t size;
+    size_t offset;
+    bool ok;
+
+    BinaryReader(const char *data, size_t size) : data(data), size(size), offset(0), ok(true) {}
+
+    template <typename T>
+    T read() {
+        T value{};
+        if (!take(sizeof(T))) return value;
+        memcpy(&value, data + offset - sizeof(T), sizeof(T));
+        return value;
+    }
+
+    string readString() {
+        uint32_t length = read<uint32_t>();
+        if (!take(length)) return string();
+        return string(data + offset - length, length);
+    }
+
+    template <typename T>
+    void readColumn(vector<T> &column, size_t rows) {
+        offset += (8 - offset % 8) % 8;
+        if (rows > size / sizeof(T)) ok = false;
+        if (!take(rows * sizeof(T))) return;
+        column.resize(rows);
+        memcpy(column.data(), data + offset - rows * sizeof(T), rows * sizeof(T));
+    }
+
+    // The next `count` values of a column in place, without copying them;
+    // nullptr on overrun
+    template <typename T>
+    const T *viewColumn(size_t count) {
+        offset += (8 - offset % 8) % 8;
+        if (count > size / sizeof(T)) ok = false;
+        if (!take(count * sizeof(T))) return nullptr;
+        return reinterpret_cast<const T *>(data + offset - count * sizeof(T));
+    }
+
+private:
+    bool take(size_t bytes) {
+        if (!ok || offset > size || bytes > size - offset) {
+            ok = false;
+            return false;
+        }
+        offset += bytes;
+        return true;
+    }
+};
+
+// Everything of a binary dataset cache before the columns, for `rows` rows
+// of the dataset's schema
+BinaryWriter binaryHeader(const Dataset &dataset, uint64_t rows) {
+    BinaryWriter out;
+    out.bytes.append(DATASET_MAGIC, 4);
+    out.write<uint32_t>(DATASET_VERSION);
+    out.write<uint64_t>(rows);
+    out.write<uint32_t>(dataset.attributes.size());
+    out.write<uint32_t>(dataset.classNames.size());
+
+    out.writeString(dataset.name);
+    for (const auto &attr : dataset.attributes) {
+        out.writeString(attr.name);
+        out.write<uint8_t>(attr.isNumerical() ? 0 : 1);
+        out.write<uint32_t>(attr.uniqueValues.size());
+        for (const auto &value : attr.uniqueValues) {
+            out.writeString(value);
+        }
+    }
+    for (const auto &className : dataset.classNames) {
+        out.writeString(className);
+    }
+    return out;
+}
+
+bool saveBinary(const Dataset &dataset, const string &filename) {
+    BinaryWriter out = binaryHeader(dataset, dataset.size());
+    for (const auto &attr : dataset.attributes) {
+        if (attr.isNumerical()) {
+            out.writeColumn(dataset.numericalColumns[attr.index]);
+        } else {
+            out.writeColumn(dataset.categoricalColumns[attr.index]);
+        }
+    }
+    out.writeColumn(dataset.labels);
+
+    ofstream file(filename, ios::binary | ios::trunc);
+    file.write(out.bytes.data(), out.bytes.size());
+    return bool(file);
+}
+
+// Every column has a value per label, every category code is inside its
+// dictionary and every label is a class id, so the columns can index rows,
+// uniqueValues and classNames unchecked
+bool validCodes(const Dataset &dataset) {
+    for (const auto &attr : dataset.attributes) {
+        size_t length = attr.isNumerical() ? dataset.numericalColumns[attr.index].size()
+                                           : dataset.categoricalColumns[attr.index].size();
+        if (length != dataset.size()) return false;
+        if (attr.isNumerical()) continue;
+        int dictionarySize = attr.uniqueValues.size();
+        for (int code : dataset.categoricalColumns[attr.index]) {
+            if (code < 0 || code >= dictionarySize) return false;
+        }
+    }
+    for (int label : dataset.labels) {
+        if (label < 0 || label >= dataset.classCount()) return false;
+    }
+    return true;
+}
+
+// Replaces `dataset` with the contents of a file written by saveBinary. The
+// file is memory-mapped and the columns are copied out in bulk; nothing is
+// parsed. Returns false (leaving `dataset` untouched) if the file is
+// missing, of another version, truncated or holds codes out of range.
+bool loadBinary(const string &filename, Dataset &dataset) {
+    MappedFile file(filename);
+    if (!file.data || file.size < 4 || memcmp(file.data, DATASET_MAGIC, 4) != 0) return false;
+    BinaryReader in(file.data, file.size);
+    in.offset = 4;
+    if (in.read<uint32_t>() != DATASET_VERSION) return false;
+    uint64_t rows = in.read<uint64_t>();
+    uint32_t attributeCount = in.read<uint32_t>();
+    uint32_t classCount = in.read<uint32_t>();
+
+    Dataset result;
+    result.name = in.readString();
+    vector<Attributes> attributes;
+    for (uint32_t i = 0; i < attributeCount && in.ok; ++i) {
+        string name = in.readString();
+        bool numerical = in.read<uint8_t>() == 0;
+        uint32_t dictionarySize = in.read<uint32_t>();
+        vector<string> values;
+        for (uint32_t code = 0; code < dictionarySize && in.ok; ++code) {
+            values.push_back(in.readString());
+        }
+        attributes.push_back(Attributes(name, numerical ? "numerical" : "categorical", values));
+    }
+    result.setAttributes(attributes);
+    for (uint32_t c = 0; c < classCount && in.ok; ++c) {
+        result.encodeClass(in.readString());
+    }
+
+    for (const auto &attr : result.attributes) {
+        if (attr.isNumerical()) {
+            in.readColumn(result.numericalColumns[attr.index], rows);
+        } else {
+            in.readColumn(result.categoricalColumns[attr.index], rows);
+        }
+    }
+    in.readColumn(result.labels, rows);
+    if (!in.ok || result.size() != rows || !validCodes(result)) return false;
+
+    dataset = move(result);
+    return true;
+}
+
+// Loads `textFile` through its binary cache: the cache is used when it is at
+// least as new as the text file, and (re)written after a text load otherwise.
+// The cache stands for one set of options, so give each its own cache file.
+bool loadCSVCached(const string &textFile, const string &cacheFile, Dataset &dataset, const CSVOptions &options = CSVOptions()) {
+    error_code textError, cacheError;
+    auto textTime = filesystem::last_write_time(textFile, textError);
+    auto cacheTime = filesystem::last_write_time(cacheFile, cacheError);
+    if (!cacheError && (textError || cacheTime >= textTime) && loadBinary(cacheFile, dataset)) {
+        return true;
+    }
+    if (!loadCSV(textFile, dataset, options)) return false;
+    saveBinary(dataset, cacheFile);
+    return true;
+}
+
+// Rows of one tree node: the slice [begin, end) of a row-index array that is
+// shared by the whole build. Children partition their parent's slice in place
+// (like quicksort does), so the feature columns are never copied.
+class DatasetView {
+public:
+    const Dataset *data;
+    vector<size_t> *rowIndices;
+    size_t begin;
+    size_t end;
+    // Attributes::index of every attribute still usable at this node
+    vector<int> attributes;
+    // Search numerical splits over the quantized bins instead of exact values
+    bool useHistograms;
+    // Split categorical attributes in two (see binaryCategoricalScores)
+    // instead of one child per category
+    bool binaryCategorical;
+    // Split candidates must leave at least this many rows in every child
+    // that gets rows
+    size_t minLeafRows;
+
+    DatasetView(const Dataset &data, vector<size_t> &rowIndices)
+        : data(&data), rowIndices(&rowIndices), begin(0), end(rowIndices.size()), useHistograms(false),
+          binaryCategorical(false), minLeafRows(1) {
+        for (const auto& attr : data.attributes) {
+            attributes.push_back(attr.index);
+        }
+    }
+
+    // Child of `parent` over [begin, end) that can no longer split on
+    // `usedAttribute` (-1 keeps every attribute)
+    DatasetView(const DatasetView &parent, size_t begin, size_t end, int usedAttribute)
+        : data(parent.data), rowIndices(parent.rowIndices), begin(begin), end(end),
+          useHistograms(parent.useHistograms), binaryCategorical(parent.binaryCategorical),
+          minLeafRows(parent.minLeafRows) {
+        for (int a : parent.attributes) {
+            if (a != usedAttribute) attributes.push_back(a);
+        }
+    }
+
+    size_t size() const {
+        return end - begin;
+    }
+
+    size_t row(size_t i) const {
+        return (*rowIndices)[begin + i];
+    }
+
+    double numerical(int column, size_t i) const {
+        return data->numericalColumns[column][row(i)];
+    }
+
+    uint8_t bin(int column, size_t i) const {
+        return data->binnedColumns[column][row(i)];
+    }
+
+    int category(int column, size_t i) const {
+        return data->categoricalColumns[column][row(i)];
+    }
+
+    int label(size_t i) const {
+        return data->labels[row(i)];
+    }
+
+    int classCount() const {
+        return data->classCount();
+    }
+
+    vector<uint32_t> classCounts() const {
+        vector<uint32_t> counts(classCount(), 0);
+        for (size_t i = 0; i < size(); ++i) {
+            counts[label(i)]++;
+        }
+        return counts;
+    }
+};
+
+// Reorders the view's rows in place so that rows with code c form the
+// c-th returned child (American flag sort: one counting pass, one cycle pass).
+vector<DatasetView> partitionByCategorical(const DatasetView& view, const Attributes& attr) {
+    const vector<int> &column = view.data->categoricalColumns[attr.index];
+    vector<size_t> &rows = *view.rowIndices;
+    size_t k = attr.uniqueValues.size();
+
+    vector<size_t> bucketStart(k + 1, 0);
+    for (size_t i = view.begin; i < view.end; ++i) {
+        bucketStart[column[rows[i]] + 1]++;
+    }
+    bucketStart[0] = view.begin;
+    for (size_t c = 1; c <= k; ++c) {
+        bucketStart[c] += bucketStart[c - 1];
+    }
+
+    vector<size_t> next(bucketStart.begin(), bucketStart.end() - 1);
+    for (size_t c = 0; c < k; ++c) {
+        while (next[c] < bucketStart[c + 1]) {
+            size_t code = column[rows[next[c]]];
+            if (code == c) {
+                next[c]++;
+            } else {
+                swap(rows[next[c]], rows[next[code]++]);
             }
-            newRows.push_back(newRow);
-            newLabels.push_back(dataset.labels[i]);
         }
     }
-    
-    for (size_t i = 0; i < newAttributes.size(); ++i) {
-        newAttributes[i].index = i;
+
+    vector<DatasetView> children;
+    for (size_t c = 0; c < k; ++c) {
+        children.emplace_back(view, bucketStart[c], bucketStart[c + 1], attr.index);
     }
-    return Dataset(dataset.name, newAttributes, newRows, newLabels);
+    return children;
+}
+
+// Reorders the view's rows in place into the codes of attr.leftCodes and
+// the rest. A category may hold rows on both sides of later splits, so both
+// children can still split on `attr`.
+pair<DatasetView, DatasetView> partitionByCategorySet(const DatasetView& view, const Attributes& attr) {
+    const vector<int> &column = view.data->categoricalColumns[attr.index];
+    const vector<uint64_t> &leftCodes = attr.leftCodes;
+    vector<size_t> &rows = *view.rowIndices;
+    auto middle = partition(rows.begin() + view.begin, rows.begin() + view.end, [&](size_t row) {
+        int code = column[row];
+        return leftCodes[code / 64] >> (code % 64) & 1;
+    });
+    size_t split = middle - rows.begin();
+    return make_pair(DatasetView(view, view.begin, split, -1), DatasetView(view, split, view.end, -1));
+}
+
+// Reorders the view's rows in place into "<= threshold" and "> threshold"
+// halves; missing values (NaN) go right.
+pair<DatasetView, DatasetView> partitionByNumerical(const DatasetView& view, const Attributes& attr, double threshold) {
+    const vector<double> &column = view.data->numericalColumns[attr.index];
+    vector<size_t> &rows = *view.rowIndices;
+    auto middle = partition(rows.begin() + view.begin, rows.begin() + view.end,
+                            [&](size_t row) { return column[row] <= threshold; });
+    size_t split = middle - rows.begin();
+    return make_pair(DatasetView(view, view.begin, split, attr.index),
+                     DatasetView(view, split, view.end, attr.index));
 }
 
 void printDataset(Dataset& dataset) {
@@ -138,13 +1019,16 @@ void printDataset(Dataset& dataset) {
         cout << "  " << attr << ", Index: " << attr.index << endl;
     }
     cout << "Rows:" << endl;
-    for (size_t i = 0; i < dataset.rows.size(); ++i) {
+    for (size_t i = 0; i < dataset.size(); ++i) {
         cout << "  ";
-        for (size_t j = 0; j < dataset.rows[i].size() - 1; ++j) {
-            cout << dataset.attributes[j].name << ": " << dataset.rows[i][j] << ", ";
+        for (auto& attr : dataset.attributes) {
+            cout << attr.name << ": ";
+            if (attr.isNumerical()) cout << dataset.numericalColumns[attr.index][i];
+            else cout << attr.uniqueValues[dataset.categoricalColumns[attr.index][i]];
+            cout << ", ";
         }
-        cout << "Label: " << dataset.labels[i] << endl;
+        cout << "Label: " << dataset.labelName(i) << endl;
     }
 }
 
-#endif // DATASET_LIBRARY_HPP
\ No newline at end of file
+#endif // DATASET_LIBRARY_HPP
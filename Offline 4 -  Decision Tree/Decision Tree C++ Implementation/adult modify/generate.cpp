@@ -0,0 +1,64 @@
+#include "attributeLibrary.hpp"
+#include "datasetLibrary.hpp"
+#include "syntheticLibrary.hpp"
+
+#include <bits/stdc++.h>
+using namespace std;
+
+// Writes a synthetic dataset (see SyntheticGenerator) for scale testing,
+// one chunk at a time (see writeSynthetic).
+//
+//   generate <output.csv | output.bin> [rows=N] [numerical=N] [categorical=N]
+//            [cardinality=N] [classes=N] [noise=X] [imbalance=X] [seed=N] [threads=N]
+//
+// A .bin output is the binary dataset cache (loadBinary); anything else is a
+// CSV with a header line (loadCSV with hasHeader = true).
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        cout << "usage: generate <output.csv | output.bin> [rows=N] [numerical=N] [categorical=N] [cardinality=N]"
+             << " [classes=N] [noise=X] [imbalance=X] [seed=N] [threads=N]" << endl;
+        return 1;
+    }
+    string output = argv[1];
+    SyntheticOptions options;
+    for (int i = 2; i < argc; ++i) {
+        string argument = argv[i];
+        size_t equals = argument.find('=');
+        string key = argument.substr(0, equals);
+        string value = equals == string::npos ? "" : argument.substr(equals + 1);
+        try {
+            if (key == "rows") options.rows = stoull(value);
+            else if (key == "numerical") options.numerical = stoi(value);
+            else if (key == "categorical") options.categorical = stoi(value);
+            else if (key == "cardinality") options.cardinality = stoi(value);
+            else if (key == "classes") options.classes = stoi(value);
+            else if (key == "noise") options.labelNoise = stod(value);
+            else if (key == "imbalance") options.imbalance = stod(value);
+            else if (key == "seed") options.seed = stoull(value);
+            else if (key == "threads") options.threads = stoi(value);
+            else throw invalid_argument(key);
+        } catch (const exception &) {
+            cout << "Invalid argument: " << argument << endl;
+            return 1;
+        }
+    }
+
+    auto start = chrono::high_resolution_clock::now();
+    SyntheticGenerator generator(options);
+    vector<uint64_t> counts;
+    if (!writeSynthetic(generator, output, counts)) {
+        cout << "Could not write " << output << endl;
+        return 1;
+    }
+    auto end = chrono::high_resolution_clock::now();
+
+    cout << "Generated " << options.rows << " rows, " << generator.schema.attributes.size()
+         << " attributes and wrote them in " << chrono::duration<double>(end - start).count() << " s" << endl;
+    cout << "Class counts:";
+    for (size_t c = 0; c < counts.size(); ++c) {
+        cout << " " << generator.schema.classNames[c] << "=" << counts[c];
+    }
+    cout << endl;
+    return 0;
+}
@@ -0,0 +1,62 @@
+#include "attributeLibrary.hpp"
+#include "datasetLibrary.hpp"
+#include "DTLibrary.hpp"
+#include "modelLibrary.hpp"
+
+#include <bits/stdc++.h>
+using namespace std;
+
+// Scores a CSV file with a saved model (see saveModel), without retraining.
+//
+//   predict <model file> <data file> [threads] [header]
+//
+// The data file has the model's attributes in order and the label last;
+// pass "header" if its first line holds column names. Prints the accuracy.
+int main(int argc, char* argv[])
+{
+    if (argc < 3) {
+        cout << "usage: predict <model file> <data file> [threads] [header]" << endl;
+        return 1;
+    }
+    string modelFile = argv[1];
+    string dataFile = argv[2];
+    int threads = (argc > 3) ? stoi(argv[3]) : max(1u, thread::hardware_concurrency());
+
+    auto start = chrono::high_resolution_clock::now();
+    TreeModel model;
+    if (!loadModel(modelFile, model)) {
+        cout << "Could not read model " << modelFile << endl;
+        return 1;
+    }
+    auto loaded = chrono::high_resolution_clock::now();
+
+    // Read the rows with the model's schema so codes and class ids match
+    Dataset data;
+    data.setAttributes(model.attributes);
+    for (const string &className : model.classNames) {
+        data.encodeClass(className);
+    }
+    CSVOptions csv;
+    csv.hasHeader = argc > 4 && string(argv[4]) == "header";
+    if (!loadCSV(dataFile, data, csv)) {
+        cout << "Could not read " << dataFile << endl;
+        return 1;
+    }
+    auto read = chrono::high_resolution_clock::now();
+
+    vector<int> predictedClasses;
+    model.predictBatch(data, predictedClasses, threads);
+    int correctPredictions = 0;
+    for (size_t row = 0; row < data.size(); ++row) {
+        correctPredictions += predictedClasses[row] == data.labels[row];
+    }
+    auto end = chrono::high_resolution_clock::now();
+
+    cout << "Model: " << model.getSize() << " nodes, depth " << model.getDepth() << ", loaded in "
+         << chrono::duration<double, milli>(loaded - start).count() << " ms" << endl;
+    cout << "Rows: " << data.size() << ", read in " << chrono::duration<double>(read - loaded).count()
+         << " s, scored in " << chrono::duration<double>(end - read).count() << " s" << endl;
+    cout << "Accuracy: " << fixed << setprecision(2)
+         << (data.size() ? 100.0 * correctPredictions / data.size() : 0.0) << " %" << endl;
+    return 0;
+}
@@ -6,6 +6,9 @@ using namespace std;
 
 #include "datasetLibrary.hpp"
 #include "attributeLibrary.hpp"
+#include "threadPoolLibrary.hpp"
+#include "histogramLibrary.hpp"
+#include "profileLibrary.hpp"
 
 enum SelectionCriteria {
     InformationGain,
@@ -13,171 +16,491 @@ enum SelectionCriteria {
     NormalizedWeightedInformationGain
 };
 
-double entropy(vector<string> labels) {
-    unordered_map<string, int> labelCount;
-    for (const auto& label : labels) {
-        labelCount[label]++;
-    }
-
+// Entropy of a node with the given per-class counts
+double entropy(const uint32_t *counts, int classCount, uint32_t total) {
     double entropyValue = 0.0;
-    double total = labels.size();
-
-    for (const auto& pair : labelCount) {
-        double probability = pair.second / total;
+    for (int c = 0; c < classCount; ++c) {
+        if (counts[c] == 0) continue;
+        double probability = counts[c] / static_cast<double>(total);
         entropyValue -= probability * log2(probability);
     }
-
     return entropyValue;
 }
 
-double IG(Dataset &dataset, Attributes &attribute) {
-    cout<<"IG"<<endl;
-    double totalEntropy = entropy(dataset.labels);
-    double weightedEntropy = 0.0;
-    
-    if (attribute.type == "categorical") {
-        map<string, vector<string>> subsets;
+double entropy(const vector<uint32_t> &counts, uint32_t total) {
+    return entropy(counts.data(), counts.size(), total);
+}
 
-        for (size_t i = 0; i < dataset.rows.size(); ++i) {
-            string attributeValue = dataset.rows[i][attribute.index];
-            subsets[attributeValue].push_back(dataset.labels[i]);
-        }
+// Best "value <= threshold" split of a numerical attribute
+class NumericalSplit {
+public:
+    double gain;
+    double threshold;
+    int leftCount;
+    int rightCount;
+    // Split points scored
+    DT_PROFILE_ONLY(uint64_t candidates = 0;)
+};
 
-        for (auto& pair : subsets) {
-            double subsetEntropy = entropy(pair.second);
-            weightedEntropy += (pair.second.size() / static_cast<double>(dataset.rows.size())) * subsetEntropy;
-        }
+// Sorts the (value, class) pairs once and sweeps them left to right with
+// running class counts, so every candidate midpoint costs O(#classes).
+// Missing values (NaN) always fall on the right side. Candidates that leave
+// fewer than view.minLeafRows rows on a side are skipped; if that leaves
+// none, the gain is -1 (no split).
+NumericalSplit bestNumericalSplit(const DatasetView &view, const Attributes &attribute) {
+    int n = view.size();
+    int classCount = view.classCount();
 
-        return totalEntropy - weightedEntropy;        
+    // Per-thread scratch, so concurrent split searches never share it and
+    // repeated calls on one thread reuse the allocation
+    static thread_local vector<pair<double, int>> sorted;
+    sorted.clear();
+    sorted.reserve(n);
+
+    vector<uint32_t> totalCounts(classCount, 0);
+    for (int i = 0; i < n; ++i) {
+        int cls = view.label(i);
+        totalCounts[cls]++;
+        double value = view.numerical(attribute.index, i);
+        if (!isnan(value)) sorted.emplace_back(value, cls);
     }
+    sort(sorted.begin(), sorted.end());
 
-    if (attribute.type == "numerical") {
-        set<double> values;
-        for (auto& row : dataset.rows) {
-            values.insert(stod(row[attribute.index]));
-        }
-        vector<double> sortedValues(values.begin(), values.end());
-        sort(sortedValues.begin(), sortedValues.end());
+    double totalEntropy = entropy(totalCounts, n);
+    int minLeaf = view.minLeafRows;
+    NumericalSplit best = {minLeaf > 1 ? -1.0 : 0.0, 0.0, 0, n};
+    vector<uint32_t> leftCounts(classCount, 0);
+    vector<uint32_t> rightCounts(classCount, 0);
 
-        double bestIG = 0.0;
-        double bestThreshold = 0.0;
+    for (size_t i = 0; i + 1 < sorted.size(); ++i) {
+        leftCounts[sorted[i].second]++;
+        if (sorted[i].first == sorted[i + 1].first) continue;
 
-        for (size_t i = 1; i < sortedValues.size(); ++i) {
-            double threshold = (sortedValues[i - 1] + sortedValues[i]) / 2.0;
+        int leftN = i + 1;
+        int rightN = n - leftN;
+        if (leftN < minLeaf || rightN < minLeaf) continue;
+        DT_PROFILE_ONLY(best.candidates++;)
+        for (int c = 0; c < classCount; ++c) {
+            rightCounts[c] = totalCounts[c] - leftCounts[c];
+        }
+        // Rounding can leave a useless split slightly below zero
+        double currentIG = max(0.0, totalEntropy -
+            (leftN / static_cast<double>(n)) * entropy(leftCounts, leftN) -
+            (rightN / static_cast<double>(n)) * entropy(rightCounts, rightN));
+        if (currentIG > best.gain) {
+            best.gain = currentIG;
+            best.threshold = (sorted[i].first + sorted[i + 1].first) / 2.0;
+            best.leftCount = leftN;
+            best.rightCount = rightN;
+        }
+    }
+    return best;
+}
 
-            vector<string> leftLabels;
-            vector<string> rightLabels;
+// Sweeps the class counts of a quantized attribute bin by bin. `counts`
+// holds classCount counters per bin, followed by one slot for missing values
+// (which always fall on the right side). minLeaf works as view.minLeafRows
+// does for bestNumericalSplit.
+NumericalSplit bestSplitFromHistogram(const uint32_t *counts, const vector<double> &thresholds, int classCount,
+                                      int minLeaf = 1) {
+    size_t bins = thresholds.size() + 1;
+    vector<uint32_t> totalCounts(classCount, 0);
+    vector<uint32_t> binCounts(bins, 0);
+    int n = 0;
+    for (size_t b = 0; b <= bins; ++b) {
+        for (int c = 0; c < classCount; ++c) {
+            totalCounts[c] += counts[b * classCount + c];
+            if (b < bins) binCounts[b] += counts[b * classCount + c];
+            n += counts[b * classCount + c];
+        }
+    }
+    int present = n;
+    for (int c = 0; c < classCount; ++c) {
+        present -= counts[bins * classCount + c];
+    }
 
-            for (size_t j = 0; j < dataset.rows.size(); ++j) {
-                if (stod(dataset.rows[j][attribute.index]) <= threshold) {
-                    leftLabels.push_back(dataset.labels[j]);
-                } else {
-                    rightLabels.push_back(dataset.labels[j]);
-                }
-            }
+    double totalEntropy = entropy(totalCounts, n);
+    NumericalSplit best = {minLeaf > 1 ? -1.0 : 0.0, 0.0, 0, n};
+    vector<uint32_t> leftCounts(classCount, 0);
+    vector<uint32_t> rightCounts(classCount, 0);
+    int leftN = 0;
 
-            double currentIG = totalEntropy - 
-                (leftLabels.size() / static_cast<double>(dataset.rows.size())) * entropy(leftLabels) - 
-                (rightLabels.size() / static_cast<double>(dataset.rows.size())) * entropy(rightLabels);
-            if (currentIG > bestIG) {
-                bestIG = currentIG;
-                bestThreshold = threshold;
-            }
+    for (size_t b = 0; b + 1 < bins; ++b) {
+        // An empty bin moves no rows, so it adds no new candidate
+        if (binCounts[b] == 0) continue;
+        for (int c = 0; c < classCount; ++c) {
+            leftCounts[c] += counts[b * classCount + c];
         }
-        attribute.threshold = bestThreshold;
+        leftN += binCounts[b];
+        if (leftN == present) break;
 
-        for (auto& attr : dataset.attributes) { 
-            if (attr == attribute) {
-                attr.threshold = bestThreshold;
-                break;
-            }
+        int rightN = n - leftN;
+        if (leftN < minLeaf || rightN < minLeaf) continue;
+        DT_PROFILE_ONLY(best.candidates++;)
+        for (int c = 0; c < classCount; ++c) {
+            rightCounts[c] = totalCounts[c] - leftCounts[c];
         }
-        return bestIG;
+        // Rounding can leave a useless split slightly below zero
+        double currentIG = max(0.0, totalEntropy -
+            (leftN / static_cast<double>(n)) * entropy(leftCounts, leftN) -
+            (rightN / static_cast<double>(n)) * entropy(rightCounts, rightN));
+        if (currentIG > best.gain) {
+            best.gain = currentIG;
+            best.threshold = thresholds[b];
+            best.leftCount = leftN;
+            best.rightCount = rightN;
+        }
+    }
+    return best;
+}
+
+// Histogram mode: one pass adds every row to a (bin, class) histogram, then
+// the sweep runs over at most 255 bins instead of the sorted rows.
+NumericalSplit bestBinnedSplit(const DatasetView &view, const Attributes &attribute) {
+    int classCount = view.classCount();
+    const vector<double> &thresholds = view.data->binThresholds[attribute.index];
+    size_t missingSlot = thresholds.size() + 1;
+    static thread_local vector<uint32_t> histogram;
+    histogram.assign((missingSlot + 1) * classCount, 0);
+    for (size_t i = 0; i < view.size(); ++i) {
+        uint8_t bin = view.bin(attribute.index, i);
+        size_t slot = bin == MISSING_BIN ? missingSlot : bin;
+        histogram[slot * classCount + view.label(i)]++;
     }
+    return bestSplitFromHistogram(histogram.data(), thresholds, classCount, view.minLeafRows);
+}
 
-    return 0.0; 
+NumericalSplit findNumericalSplit(const DatasetView &view, const Attributes &attribute) {
+    if (view.useHistograms) {
+        return bestBinnedSplit(view, attribute);
+    }
+    return bestNumericalSplit(view, attribute);
 }
 
-double IGR(Dataset &dataset, Attributes &attribute) {
-    double ig = IG(dataset, attribute); 
-    double intrinsicValue = 0.0;
-    double total = dataset.rows.size();
+const int CRITERIA_COUNT = 3;
 
-    if (attribute.type == "categorical") {
-        map<string, int> valueCount;
-        for (auto& row : dataset.rows) {
-            valueCount[row[attribute.index]]++;
-        }
-        for (auto& pair : valueCount) {
-            double probability = pair.second / total;
-            if (probability > 0)
-                intrinsicValue -= probability * log2(probability);
-        }
-    } else if (attribute.type == "numerical") {
-        double threshold = attribute.threshold;
-        int leftCount = 0, rightCount = 0;
-        for (auto& row : dataset.rows) {
-            double value = stod(row[attribute.index]);
-            if (value <= threshold)
-                leftCount++;
-            else
-                rightCount++;
-        }
-        double leftProb = leftCount / total;
-        double rightProb = rightCount / total;
+// Scores of one attribute under every criterion, all from the same class
+// counts. `threshold` is the split point of a numerical attribute and
+// `leftCodes` the first child's categories of a binary categorical split;
+// both are chosen by information gain, so they are the same for every
+// criterion.
+class SplitScores {
+public:
+    double score[CRITERIA_COUNT];
+    double threshold;
+    vector<uint64_t> leftCodes;
+    // Split points scored: thresholds of a numerical attribute, partitions
+    // of a binary categorical one, 1 for a multiway categorical split
+    DT_PROFILE_ONLY(uint64_t candidates = 0;)
+
+    SplitScores() : score{0.0, 0.0, 0.0}, threshold(0.0) {}
+};
+
+// Scores that no criterion picks (see bestScore): the attribute cannot split
+SplitScores unsplittable() {
+    SplitScores scores;
+    fill(scores.score, scores.score + CRITERIA_COUNT, -1.0);
+    return scores;
+}
+
+// Scores of a numerical (two-way) split; a negative gain means no split
+SplitScores numericalScores(const NumericalSplit &split) {
+    if (split.gain < 0) return unsplittable();
+    SplitScores scores;
+    scores.threshold = split.threshold;
+    DT_PROFILE_ONLY(scores.candidates = split.candidates;)
+    double n = split.leftCount + split.rightCount;
+    scores.score[InformationGain] = split.gain;
+
+    if (split.gain > 0) {
+        double intrinsicValue = 0.0;
+        double leftProb = split.leftCount / n;
+        double rightProb = split.rightCount / n;
         if (leftProb > 0)
             intrinsicValue -= leftProb * log2(leftProb);
         if (rightProb > 0)
             intrinsicValue -= rightProb * log2(rightProb);
+        scores.score[InformationGainRatio] = (intrinsicValue != 0) ? (split.gain / intrinsicValue) : 0.0;
+    }
+
+    double k = 2;
+    if (n != 0) {
+        scores.score[NormalizedWeightedInformationGain] = (split.gain / log2(k + 1)) * (1 - (k - 1) / n);
+    }
+    return scores;
+}
+
+double numericalScore(const NumericalSplit &split, int criterion) {
+    return numericalScores(split).score[criterion];
+}
+
+// Scores of a multiway categorical split. `counts` holds classCount
+// counters per category code. The split is refused if a category present
+// has fewer than minLeaf rows.
+SplitScores categoricalScores(const uint32_t *counts, int codes, int classCount, int minLeaf = 1) {
+    SplitScores scores;
+    vector<uint32_t> totalCounts(classCount, 0);
+    vector<uint32_t> codeCounts(codes, 0);
+    uint32_t n = 0;
+    for (int v = 0; v < codes; ++v) {
+        for (int c = 0; c < classCount; ++c) {
+            totalCounts[c] += counts[v * classCount + c];
+            codeCounts[v] += counts[v * classCount + c];
+        }
+        n += codeCounts[v];
+    }
+    if (n == 0) return scores;
+    for (int v = 0; v < codes; ++v) {
+        if (codeCounts[v] > 0 && (int)codeCounts[v] < minLeaf) return unsplittable();
+    }
+    DT_PROFILE_ONLY(scores.candidates = 1;)
+
+    double weightedEntropy = 0.0;
+    double intrinsicValue = 0.0;
+    double k = 0;
+    for (int v = 0; v < codes; ++v) {
+        if (codeCounts[v] == 0) continue;
+        double probability = codeCounts[v] / static_cast<double>(n);
+        weightedEntropy += probability * entropy(counts + v * classCount, classCount, codeCounts[v]);
+        intrinsicValue -= probability * log2(probability);
+        k++;
     }
+    double ig = entropy(totalCounts, n) - weightedEntropy;
+
+    scores.score[InformationGain] = ig;
+    scores.score[InformationGainRatio] = (intrinsicValue != 0) ? (ig / intrinsicValue) : 0.0;
+    scores.score[NormalizedWeightedInformationGain] = (ig / log2(k + 1)) * (1 - (k - 1) / n);
+    return scores;
+}
 
-    return (intrinsicValue != 0) ? (ig / intrinsicValue) : 0.0;
+double categoricalScore(const uint32_t *counts, int codes, int classCount, int criterion) {
+    return categoricalScores(counts, codes, classCount).score[criterion];
 }
 
-double NWIG(Dataset &dataset, Attributes &attribute) {
-    double ig = IG(dataset, attribute);  
-    double n = dataset.rows.size();
+// Scores of the best two-way split of a categorical attribute. The present
+// categories are sorted by their share of one class and every prefix of that
+// order is tried as the first child, which finds the best partition for two
+// classes (Breiman et al.) in O(k log k) instead of 2^(k-1). With more
+// classes each class gives one order and the best prefix of any is taken.
+// Categories without rows here go with the larger child. Partitions with
+// fewer than minLeaf rows on a side are skipped. An attribute with no
+// partition left (or fewer than two categories present) cannot split.
+SplitScores binaryCategoricalScores(const uint32_t *counts, int codes, int classCount, int minLeaf = 1) {
+    SplitScores scores;
+    vector<uint32_t> totalCounts(classCount, 0);
+    vector<uint32_t> codeCounts(codes, 0);
+    vector<int> present;
+    uint32_t n = 0;
+    for (int v = 0; v < codes; ++v) {
+        for (int c = 0; c < classCount; ++c) {
+            totalCounts[c] += counts[v * classCount + c];
+            codeCounts[v] += counts[v * classCount + c];
+        }
+        n += codeCounts[v];
+        if (codeCounts[v] > 0) present.push_back(v);
+    }
+    if (present.size() < 2) return unsplittable();
+
+    double totalEntropy = entropy(totalCounts, n);
+    NumericalSplit best = {-1.0, 0.0, 0, (int)n};
+    vector<int> bestOrder;
+    size_t bestPrefix = 0;
+    vector<uint32_t> leftCounts(classCount);
+    vector<uint32_t> rightCounts(classCount);
+    // With two classes the order by class 0 is the reverse of the one by class 1
+    for (int sortClass = classCount == 2 ? 1 : 0; sortClass < classCount; ++sortClass) {
+        vector<int> order = present;
+        stable_sort(order.begin(), order.end(), [&](int a, int b) {
+            return (uint64_t)counts[a * classCount + sortClass] * codeCounts[b] <
+                   (uint64_t)counts[b * classCount + sortClass] * codeCounts[a];
+        });
+        fill(leftCounts.begin(), leftCounts.end(), 0);
+        int leftN = 0;
+        for (size_t i = 0; i + 1 < order.size(); ++i) {
+            for (int c = 0; c < classCount; ++c) {
+                leftCounts[c] += counts[order[i] * classCount + c];
+            }
+            leftN += codeCounts[order[i]];
+            int rightN = n - leftN;
+            if (leftN < minLeaf || rightN < minLeaf) continue;
+            DT_PROFILE_ONLY(best.candidates++;)
+            for (int c = 0; c < classCount; ++c) {
+                rightCounts[c] = totalCounts[c] - leftCounts[c];
+            }
+            double currentIG = max(0.0, totalEntropy -
+                (leftN / static_cast<double>(n)) * entropy(leftCounts, leftN) -
+                (rightN / static_cast<double>(n)) * entropy(rightCounts, rightN));
+            if (currentIG > best.gain) {
+                best.gain = currentIG;
+                best.leftCount = leftN;
+                best.rightCount = rightN;
+                bestOrder = order;
+                bestPrefix = i + 1;
+            }
+        }
+    }
+
+    if (best.gain < 0) return unsplittable();
+    scores = numericalScores(best);
+    scores.threshold = 0.0;
+    bool absentLeft = best.leftCount > best.rightCount;
+    scores.leftCodes.assign((codes + 63) / 64, 0);
+    for (int v = 0; v < codes; ++v) {
+        if (codeCounts[v] == 0 && absentLeft) scores.leftCodes[v / 64] |= 1ULL << (v % 64);
+    }
+    for (size_t i = 0; i < bestPrefix; ++i) {
+        scores.leftCodes[bestOrder[i] / 64] |= 1ULL << (bestOrder[i] % 64);
+    }
+    return scores;
+}
 
-    double k = 0; 
+// (category code, class) counts of a categorical attribute over the view
+const vector<uint32_t> &countCategories(const DatasetView &view, const Attributes &attribute) {
+    int classCount = view.classCount();
+    static thread_local vector<uint32_t> counts;
+    counts.assign(attribute.uniqueValues.size() * classCount, 0);
+    for (size_t i = 0; i < view.size(); ++i) {
+        counts[view.category(attribute.index, i) * classCount + view.label(i)]++;
+    }
+    return counts;
+}
 
-    if (attribute.type == "categorical") {
-        set<string> uniqueVals;
-        for (auto& row : dataset.rows)
-            uniqueVals.insert(row[attribute.index]);
-        k = uniqueVals.size();
-    } else if (attribute.type == "numerical") {
-        k = 2;
+// One statistics pass over the view's rows for `attribute`
+SplitScores scoreAttribute(const DatasetView &view, const Attributes &attribute) {
+    if (attribute.isNumerical()) {
+        return numericalScores(findNumericalSplit(view, attribute));
     }
-    if (k == 0 || n == 0) return 0;
-    return (ig / log2(k + 1)) * (1 - (k - 1) / n);
+    const vector<uint32_t> &counts = countCategories(view, attribute);
+    if (view.binaryCategorical) {
+        return binaryCategoricalScores(counts.data(), attribute.uniqueValues.size(), view.classCount(),
+                                       view.minLeafRows);
+    }
+    return categoricalScores(counts.data(), attribute.uniqueValues.size(), view.classCount(), view.minLeafRows);
+}
+
+// Scores `attribute` on the rows of `view`; for numerical attributes the
+// chosen split point is returned through `threshold`.
+double attributeScore(const DatasetView &view, const Attributes &attribute, int criterion, double &threshold) {
+    SplitScores scores = scoreAttribute(view, attribute);
+    threshold = scores.threshold;
+    return scores.score[criterion];
+}
+
+double IG(const DatasetView &view, const Attributes &attribute, double &threshold) {
+    return attributeScore(view, attribute, InformationGain, threshold);
+}
+
+double IGR(const DatasetView &view, const Attributes &attribute, double &threshold) {
+    return attributeScore(view, attribute, InformationGainRatio, threshold);
+}
+
+double NWIG(const DatasetView &view, const Attributes &attribute, double &threshold) {
+    return attributeScore(view, attribute, NormalizedWeightedInformationGain, threshold);
 }
 
-double selectionCriteria(Dataset &dataset, Attributes &attribute, int criterion) {
+double selectionCriteria(const DatasetView &view, const Attributes &attribute, int criterion, double &threshold) {
     switch (criterion) {
         case InformationGain:
-            return IG(dataset, attribute);
+            return IG(view, attribute, threshold);
         case InformationGainRatio:
-            return IGR(dataset, attribute);
+            return IGR(view, attribute, threshold);
         case NormalizedWeightedInformationGain:
-            return NWIG(dataset, attribute);
+            return NWIG(view, attribute, threshold);
         default:
             return 0.0;
     }
 }
 
-Attributes findBestAttribute(Dataset &dataset, int criterion) {
+// Scores of every attribute still usable at the view, in view.attributes
+// order. With a pool every attribute is scored as its own task.
+vector<SplitScores> scoreAttributes(const DatasetView &view, ThreadPool *pool = nullptr) {
+    size_t count = view.attributes.size();
+    vector<SplitScores> scores(count);
+    if (pool) {
+        TaskGroup tasks(*pool);
+        for (size_t i = 0; i < count; ++i) {
+            tasks.run([&, i] {
+                scores[i] = scoreAttribute(view, view.data->attributes[view.attributes[i]]);
+            });
+        }
+        tasks.wait();
+    } else {
+        for (size_t i = 0; i < count; ++i) {
+            scores[i] = scoreAttribute(view, view.data->attributes[view.attributes[i]]);
+        }
+    }
+    return scores;
+}
+
+// Position of the best attribute under `criterion` in scores (and
+// view.attributes), or -1 if there is none. Ties go to the attribute listed
+// first (lowest index), so the choice does not depend on task order.
+int bestScore(const vector<SplitScores> &scores, int criterion) {
     double bestValue = -1.0;
-    Attributes bestAttribute;
-    
-    for (auto& attribute : dataset.attributes) {
-        double value = selectionCriteria(dataset, attribute, criterion);
-        if (value > bestValue) {
-            bestValue = value;
-            bestAttribute = attribute;
+    int best = -1;
+    for (size_t i = 0; i < scores.size(); ++i) {
+        if (scores[i].score[criterion] > bestValue) {
+            bestValue = scores[i].score[criterion];
+            best = i;
         }
     }
-    
-    return bestAttribute;
+    return best;
+}
+
+// The attribute at position `best` of view.attributes, carrying its threshold
+Attributes chosenAttribute(const DatasetView &view, const vector<SplitScores> &scores, int best) {
+    Attributes attribute;
+    if (best >= 0) {
+        attribute = view.data->attributes[view.attributes[best]];
+        attribute.threshold = scores[best].threshold;
+        attribute.leftCodes = scores[best].leftCodes;
+    }
+    return attribute;
+}
+
+Attributes findBestAttribute(const DatasetView &view, int criterion, ThreadPool *pool = nullptr) {
+    vector<SplitScores> scores = scoreAttributes(view, pool);
+    return chosenAttribute(view, scores, bestScore(scores, criterion));
+}
+
+// Scores `attribute` from the histogram of the node `view` (see
+// HistogramLayout) without touching the node's rows. Gives the same values
+// as selectionCriteria in histogram mode.
+SplitScores scoresFromHistogram(const DatasetView &view, const Attributes &attribute, const HistogramLayout &layout,
+                                const vector<uint32_t> &histogram) {
+    const uint32_t *counts = layout.counts(histogram, attribute.index);
+    int minLeaf = view.minLeafRows;
+    if (attribute.isNumerical()) {
+        return numericalScores(
+            bestSplitFromHistogram(counts, view.data->binThresholds[attribute.index], layout.classCount, minLeaf));
+    }
+    if (view.binaryCategorical) {
+        return binaryCategoricalScores(counts, layout.slots[attribute.index], layout.classCount, minLeaf);
+    }
+    return categoricalScores(counts, layout.slots[attribute.index], layout.classCount, minLeaf);
+}
+
+double scoreFromHistogram(const DatasetView &view, const Attributes &attribute, int criterion,
+                          const HistogramLayout &layout, const vector<uint32_t> &histogram, double &threshold) {
+    SplitScores scores = scoresFromHistogram(view, attribute, layout, histogram);
+    threshold = scores.threshold;
+    return scores.score[criterion];
+}
+
+// scoreAttributes for a node whose histogram is already built
+vector<SplitScores> scoreAttributes(const DatasetView &view, const HistogramLayout &layout,
+                                    const vector<uint32_t> &histogram) {
+    vector<SplitScores> scores;
+    for (int column : view.attributes) {
+        scores.push_back(scoresFromHistogram(view, view.data->attributes[column], layout, histogram));
+    }
+    return scores;
+}
+
+// findBestAttribute for a node whose histogram is already built
+Attributes findBestAttribute(const DatasetView &view, int criterion, const HistogramLayout &layout, const vector<uint32_t> &histogram) {
+    vector<SplitScores> scores = scoreAttributes(view, layout, histogram);
+    return chosenAttribute(view, scores, bestScore(scores, criterion));
 }
 
-#endif // SELECTION_CRITERIA_LIBRARY_HPP
\ No newline at end of file
+#endif // SELECTION_CRITERIA_LIBRARY_HPP
@@ -0,0 +1,273 @@
+#ifndef SYNTHETIC_LIBRARY_HPP
+#define SYNTHETIC_LIBRARY_HPP
+
+#include <bits/stdc++.h>
+using namespace std;
+
+#include "attributeLibrary.hpp"
+#include "datasetLibrary.hpp"
+#include "threadPoolLibrary.hpp"
+
+// Shape of a synthetic dataset. Everything is derived from `seed`, so the
+// same options always give the same rows, whatever the thread count.
+class SyntheticOptions {
+public:
+    size_t rows;
+    int numerical;
+    int categorical;
+    // Categories per categorical attribute (up to 10^4)
+    int cardinality;
+    int classes;
+    // Share of rows whose label is replaced by a uniformly drawn class
+    double labelNoise;
+    // Class c gets a share of rows proportional to imbalance^c before noise:
+    // 1 is balanced, 0.1 makes every class ten times rarer than the one before
+    double imbalance;
+    uint64_t seed;
+    int threads;
+
+    SyntheticOptions()
+        : rows(100000), numerical(8), categorical(4), cardinality(16), classes(2), labelNoise(0.05),
+          imbalance(1.0), seed(318), threads(0) {}
+};
+
+// Counter-based random numbers: every (row, column) cell has its own value,
+// so cells can be generated in any order and on any thread
+uint64_t syntheticHash(uint64_t seed, uint64_t row, uint64_t column) {
+    uint64_t z = seed ^ (row * 0x9E3779B97F4A7C15ULL) ^ (column * 0xD1B54A32D192ED03ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Uniform in [0, 1)
+double syntheticUniform(uint64_t seed, uint64_t row, uint64_t column) {
+    return (syntheticHash(seed, row, column) >> 11) * 0x1.0p-53;
+}
+
+// Rows generated per chunk by generateSynthetic and writeSynthetic
+const size_t SYNTHETIC_CHUNK_ROWS = 1 << 20;
+// Rows whose scores place the class cuts (see SyntheticGenerator)
+const size_t SYNTHETIC_SAMPLE_ROWS = 1 << 20;
+
+// The rows of a synthetic dataset: attributes num0.. (values in [0, 1000)
+// with two decimals) and cat0.. (codes skewed towards the first
+// categories), then class labels class0.. drawn from a hidden additive rule
+// that a tree can learn: every numerical attribute adds +-w around its own
+// cut point and every category of a categorical attribute its own effect.
+// Class c takes the next imbalance share of rows in score order (ties
+// broken by row), then labelNoise of them get a random class. The class
+// cuts are placed on the scores of SYNTHETIC_SAMPLE_ROWS evenly spaced
+// rows, so they are exact up to that many rows and any range of rows can
+// be generated on its own. Names are zero padded so dictionaries come out
+// in code order, as loadCSV would sort them.
+class SyntheticGenerator {
+public:
+    SyntheticOptions options;
+    // Attributes, dictionaries and class names; no rows
+    Dataset schema;
+
+    explicit SyntheticGenerator(const SyntheticOptions &options) : options(options) {
+        auto padded = [](const string &prefix, int value, int count) {
+            string digits = to_string(value);
+            return prefix + string(to_string(max(count - 1, 0)).size() - digits.size(), '0') + digits;
+        };
+
+        cardinality = max(1, options.cardinality);
+        vector<Attributes> attributes;
+        for (int j = 0; j < options.numerical; ++j) {
+            attributes.emplace_back(padded("num", j, options.numerical), "numerical", vector<string>());
+        }
+        for (int j = 0; j < options.categorical; ++j) {
+            vector<string> categories;
+            for (int v = 0; v < cardinality; ++v) categories.push_back(padded("v", v, cardinality));
+            attributes.emplace_back(padded("cat", j, options.categorical), "categorical", categories);
+        }
+        schema.name = "Synthetic Dataset";
+        schema.setAttributes(attributes);
+        classes = max(1, options.classes);
+        for (int c = 0; c < classes; ++c) {
+            schema.encodeClass(padded("class", c, classes));
+        }
+
+        // The hidden rule, drawn from the seed on "row" UINT64_MAX
+        uint64_t ruleRow = UINT64_MAX;
+        weight.resize(attributes.size());
+        cut.resize(attributes.size());
+        effect.resize(attributes.size());
+        for (size_t j = 0; j < attributes.size(); ++j) {
+            weight[j] = 0.2 + syntheticUniform(options.seed, ruleRow, 3 * j);
+            cut[j] = 200 + 600 * syntheticUniform(options.seed, ruleRow, 3 * j + 1);
+            if (!attributes[j].isNumerical()) {
+                for (int v = 0; v < cardinality; ++v) {
+                    effect[j].push_back(weight[j] * (2 * syntheticUniform(options.seed ^ 1, v, j) - 1));
+                }
+            }
+        }
+
+        // Class c + 1 starts where the sample's share of class c ends
+        size_t rows = options.rows;
+        size_t sampleRows = min(rows, SYNTHETIC_SAMPLE_ROWS);
+        vector<pair<double, uint64_t>> sample(sampleRows);
+        for (size_t i = 0; i < sampleRows; ++i) {
+            uint64_t row = (uint64_t)((unsigned __int128)i * rows / sampleRows);
+            sample[i] = {scoreRow(row), row};
+        }
+        sort(sample.begin(), sample.end());
+        vector<double> share(classes);
+        double shareSum = 0.0;
+        for (int c = 0; c < classes; ++c) {
+            share[c] = pow(options.imbalance, c);
+            shareSum += share[c];
+        }
+        double cumulative = 0.0;
+        for (int c = 0; c + 1 < classes; ++c) {
+            cumulative += share[c] / shareSum;
+            size_t last = min(sampleRows, (size_t)llround(cumulative * sampleRows));
+            classStarts.push_back(last < sampleRows ? sample[last] : make_pair(HUGE_VAL, UINT64_MAX));
+        }
+    }
+
+    // Replaces the columns and labels of `chunk`, a copy of `schema`, with
+    // rows [begin, end), generated on `pool` if one is given
+    void generate(size_t begin, size_t end, Dataset &chunk, ThreadPool *pool = nullptr) const {
+        size_t rows = end - begin;
+        for (const auto &attr : schema.attributes) {
+            if (attr.isNumerical()) chunk.numericalColumns[attr.index].resize(rows);
+            else chunk.categoricalColumns[attr.index].resize(rows);
+        }
+        chunk.labels.resize(rows);
+
+        // Every column sits at its own hash column; labels use the next two
+        uint64_t noiseColumn = schema.attributes.size(), classColumn = schema.attributes.size() + 1;
+        auto fill = [&](size_t first, size_t last) {
+            for (size_t i = first; i < last; ++i) {
+                uint64_t row = begin + i;
+                double score = scoreRow(row, &chunk, i);
+                int label = upper_bound(classStarts.begin(), classStarts.end(), make_pair(score, row)) -
+                            classStarts.begin();
+                if (syntheticUniform(options.seed, row, noiseColumn) < options.labelNoise) {
+                    label = min<int>(classes - 1, syntheticUniform(options.seed, row, classColumn) * classes);
+                }
+                chunk.labels[i] = label;
+            }
+        };
+        const size_t blockRows = 1 << 16;
+        if (pool && rows > blockRows) {
+            TaskGroup tasks(*pool);
+            for (size_t first = 0; first < rows; first += blockRows) {
+                size_t last = min(rows, first + blockRows);
+                tasks.run([&fill, first, last] { fill(first, last); });
+            }
+            tasks.wait();
+        } else {
+            fill(0, rows);
+        }
+    }
+
+private:
+    int cardinality;
+    int classes;
+    vector<double> weight, cut;
+    vector<vector<double>> effect;
+    // (score, row) of the first row of classes 1.. in score order
+    vector<pair<double, uint64_t>> classStarts;
+
+    // Score of `row` under the hidden rule. With a chunk, also stores the
+    // row's cells at `index` of its columns.
+    double scoreRow(uint64_t row, Dataset *chunk = nullptr, size_t index = 0) const {
+        double total = 0.0;
+        for (const auto &attr : schema.attributes) {
+            size_t j = attr.index;
+            double u = syntheticUniform(options.seed, row, j);
+            if (attr.isNumerical()) {
+                double value = floor(u * 100000) / 100;
+                if (chunk) chunk->numericalColumns[j][index] = value;
+                total += value < cut[j] ? -weight[j] : weight[j];
+            } else {
+                int code = min<int>(cardinality - 1, u * u * cardinality);
+                if (chunk) chunk->categoricalColumns[j][index] = code;
+                total += effect[j][code];
+            }
+        }
+        return total;
+    }
+};
+
+// Fills `dataset` with options.rows rows of the SyntheticGenerator
+void generateSynthetic(const SyntheticOptions &options, Dataset &dataset) {
+    SyntheticGenerator generator(options);
+    Dataset result = generator.schema;
+    int threads = options.threads > 0 ? options.threads : max(1u, thread::hardware_concurrency());
+    unique_ptr<ThreadPool> threadPool;
+    if (threads > 1) threadPool = make_unique<ThreadPool>(threads - 1);
+    generator.generate(0, options.rows, result, threadPool.get());
+    dataset = move(result);
+}
+
+// Writes the rows generateSynthetic would fill straight to `filename`,
+// SYNTHETIC_CHUNK_ROWS at a time, so memory stays at one chunk however many
+// rows there are. A name ending in ".bin" gets the binary dataset cache
+// (see saveBinary), anything else CSV with a header line (see saveCSV).
+// classCounts gets the rows of each class. Returns false if the file
+// cannot be written.
+bool writeSynthetic(const SyntheticGenerator &generator, const string &filename, vector<uint64_t> &classCounts) {
+    const Dataset &schema = generator.schema;
+    size_t rows = generator.options.rows;
+    bool binary = filename.size() >= 4 && filename.compare(filename.size() - 4, 4, ".bin") == 0;
+    ofstream file(filename, ios::binary | ios::trunc);
+    if (!file) return false;
+
+    // The binary columns have fixed sizes, so every chunk is written at its
+    // place in each column
+    vector<uint64_t> columnStart;
+    if (binary) {
+        BinaryWriter header = binaryHeader(schema, rows);
+        file.write(header.bytes.data(), header.bytes.size());
+        uint64_t offset = header.bytes.size();
+        for (const auto &attr : schema.attributes) {
+            offset += (8 - offset % 8) % 8;
+            columnStart.push_back(offset);
+            offset += rows * (attr.isNumerical() ? sizeof(double) : sizeof(int));
+        }
+        offset += (8 - offset % 8) % 8;
+        columnStart.push_back(offset);
+    } else {
+        file << csvHeader(schema);
+    }
+
+    int threads = generator.options.threads > 0 ? generator.options.threads : max(1u, thread::hardware_concurrency());
+    unique_ptr<ThreadPool> threadPool;
+    if (threads > 1) threadPool = make_unique<ThreadPool>(threads - 1);
+    classCounts.assign(schema.classCount(), 0);
+    Dataset chunk = schema;
+    for (size_t begin = 0; begin < rows; begin += SYNTHETIC_CHUNK_ROWS) {
+        size_t end = min(rows, begin + SYNTHETIC_CHUNK_ROWS);
+        generator.generate(begin, end, chunk, threadPool.get());
+        for (int label : chunk.labels) {
+            classCounts[label]++;
+        }
+        if (!binary) {
+            writeCSVRows(chunk, file);
+            continue;
+        }
+        auto place = [&](uint64_t start, const auto &column) {
+            using T = typename decay_t<decltype(column)>::value_type;
+            file.seekp(start + begin * sizeof(T));
+            file.write(reinterpret_cast<const char *>(column.data()), column.size() * sizeof(T));
+        };
+        for (const auto &attr : schema.attributes) {
+            if (attr.isNumerical()) place(columnStart[attr.index], chunk.numericalColumns[attr.index]);
+            else place(columnStart[attr.index], chunk.categoricalColumns[attr.index]);
+        }
+        place(columnStart.back(), chunk.labels);
+    }
+    if (binary && rows == 0) {
+        // No column wrote its padding
+        file.seekp(0, ios::end);
+        file << string(columnStart.back() - file.tellp(), '\0');
+    }
+    return bool(file);
+}
+
+#endif // SYNTHETIC_LIBRARY_HPP
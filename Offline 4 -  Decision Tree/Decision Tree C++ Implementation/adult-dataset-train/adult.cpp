@@ -2,70 +2,17 @@
 #include "datasetLibrary.hpp"
 #include "selectionCriteriaLibrary.hpp"
 #include "DTLibrary.hpp"
+#include "experimentLibrary.hpp"
 
 #include <bits/stdc++.h>
 using namespace std;
 
 
-void loadIrisCSV(const string& filename, Dataset& dataset) {
-    ifstream file(filename);
-    string line; 
-
-    while (getline(file, line)) {
-        //cout<<line<<endl;
-        stringstream ss(line);
-        vector<string> cells;
-        string cell;
-
-        while (getline(ss, cell, ',')) {
-            cells.push_back(cell);
-        }
-
-        map<Attributes, string> data;
-
-        for (size_t i = 0; i < dataset.attributes.size(); ++i) {
-            data[dataset.attributes[i]] = cells[i]; 
-            
-        }
-        string label = cells.back(); 
-
-        dataset.rows.emplace_back(data, label);
-        dataset.labels.push_back(label);
-    }
-}
-
 void run(Dataset& dataset) {
-    vector<int> maxDepths = {1, 2, 3, 4, 5,6};
-    vector<SelectionCriteria> criteria = {InformationGain, InformationGainRatio, NormalizedWeightedInformationGain};
-    ofstream outputFile("adult_imputed.data");
-    outputFile << "Max Depth,Selection Criteria,trainTime(ms),treeSize,Accuracy(%)\n";
-
-    for (int maxDepth : maxDepths) {
-        for (SelectionCriteria criterion : criteria) {
-            double avgTrainTime = 0.0, avgAccuracy = 0.0, avgTreeSize = 0.0;
-            for (int i = 1; i <= 20; i++) {
-                pair<Dataset, Dataset> split = trainTestSplitRandom(dataset, 0.8);
-                auto start = chrono::high_resolution_clock::now();
-                DecisionTree dt(split.first, criterion, maxDepth);
-                auto end = chrono::high_resolution_clock::now();
-                chrono::duration<double, milli> trainTime = end - start;
-                avgTrainTime += trainTime.count();
-                avgTreeSize += dt.getSize();
-
-                int correctPredictions = 0;
-                for (auto& row : split.second.rows) {
-                    string predictedLabel = dt.predictLabel(row);
-                    if (predictedLabel == row.label) {
-                        correctPredictions++;
-                    }
-                }
-
-                avgAccuracy += static_cast<double>(correctPredictions) / split.second.rows.size() * 100;
-            }
-
-            outputFile << maxDepth << "," << criterion << "," << avgTrainTime / 20 << "," << (int)(avgTreeSize / 20) << "," << avgAccuracy / 20 << "\n";
-        }
-    }
+    // maxDepth 1-6 x IG/IGR/NWIG, 20 seeded splits each (see ExperimentGrid)
+    ExperimentGrid grid;
+    grid.output = "adult_imputed_results.csv";
+    writeExperimentCSV(runExperiment(dataset, grid), grid.output);
 }
 
 // int main()
@@ -89,8 +36,8 @@ void run(Dataset& dataset) {
 //     Attributes("native-country", "categorical", {"Cambodia", "Canada", "China", "Columbia", "Cuba", "Dominican-Republic", "Ecuador", "El-Salvador", "England", "France", "Germany", "Greece", "Guatemala", "Haiti", "Holand-Netherlands", "Honduras", "Hong", "Hungary", "India", "Iran", "Ireland", "Italy", "Jamaica", "Japan", "Laos", "Mexico", "Nicaragua", "Outlying-US(Guam-USVI-etc)", "Peru", "Philippines", "Poland", "Portugal", "Puerto-Rico", "Scotland", "South", "Taiwan", "Thailand", "Trinadad&Tobago", "United-States", "Vietnam", "Yugoslavia"}),
 // };
 
-//     dataset.attributes = attributes;
-//     loadIrisCSV("adult_imputed.data", dataset);
+//     dataset.setAttributes(attributes);
+//     loadCSV("adult_imputed.data", dataset);
 //     //printDataset(dataset);
 
 
@@ -132,33 +79,22 @@ int main(int argc, char* argv[])
 
     Dataset dataset;
     dataset.name = "Adult Dataset";
-    vector<Attributes> attributes = {
-        Attributes("Age", "numerical", {}),
-        Attributes("workclass", "categorical", {"Federal-gov", "Local-gov", "Never-worked", "Private", "Self-emp-inc", "Self-emp-not-inc", "State-gov", "Without-pay"}),
-        Attributes("workclass_code", "numerical", {}),
-        Attributes("education", "categorical", {"10th", "11th", "12th", "1st-4th", "5th-6th", "7th-8th", "9th", "Assoc-acdm", "Assoc-voc", "Bachelors", "Doctorate", "HS-grad", "Masters", "Preschool", "Prof-school", "Some-college"}),
-        Attributes("education_num", "numerical", {}),
-        Attributes("marital-status", "categorical", {"Divorced", "Married-AF-spouse", "Married-civ-spouse", "Married-spouse-absent", "Never-married", "Separated", "Widowed"}),
-        Attributes("occupation", "categorical", {"Adm-clerical", "Armed-Forces", "Craft-repair", "Exec-managerial", "Farming-fishing", "Handlers-cleaners", "Machine-op-inspct", "Other-service", "Priv-house-serv", "Prof-specialty", "Protective-serv", "Sales", "Tech-support", "Transport-moving"}),
-        Attributes("relationship", "categorical", {"Husband", "Not-in-family", "Other-relative", "Own-child", "Unmarried", "Wife"}),
-        Attributes("race", "categorical", {"Amer-Indian-Eskimo", "Asian-Pac-Islander", "Black", "Other", "White"}),
-        Attributes("sex", "categorical", {"Female", "Male"}),
-        Attributes("capital-gain", "numerical", {}),
-        Attributes("capital-loss", "numerical", {}),
-        Attributes("hours-per-week", "numerical", {}),
-        Attributes("native-country", "categorical", {"Cambodia", "Canada", "China", "Columbia", "Cuba", "Dominican-Republic", "Ecuador", "El-Salvador", "England", "France", "Germany", "Greece", "Guatemala", "Haiti", "Holand-Netherlands", "Honduras", "Hong", "Hungary", "India", "Iran", "Ireland", "Italy", "Jamaica", "Japan", "Laos", "Mexico", "Nicaragua", "Outlying-US(Guam-USVI-etc)", "Peru", "Philippines", "Poland", "Portugal", "Puerto-Rico", "Scotland", "South", "Taiwan", "Thailand", "Trinadad&Tobago", "United-States", "Vietnam", "Yugoslavia"}),
-    };
-    dataset.attributes = attributes;
 
 
     
  cout << "Loading dataset..." << endl;
     auto load_start = std::chrono::high_resolution_clock::now();
-    loadIrisCSV("adult_imputed.data", dataset);
+    // No header line: name the fields; types and dictionaries are inferred.
+    // Later runs read the binary cache instead of the text.
+    CSVOptions csv;
+    csv.names = {"Age", "workclass", "workclass_code", "education", "education_num", "marital-status",
+                 "occupation", "relationship", "race", "sex", "capital-gain", "capital-loss",
+                 "hours-per-week", "native-country", "income"};
+    loadCSVCached("adult_imputed.data", "adult_imputed.bin", dataset, csv);
     auto load_end = std::chrono::high_resolution_clock::now();
     double loading_time = std::chrono::duration<double>(load_end - load_start).count();
-    cout << "Loaded " << dataset.rows.size() << " rows." << endl;
-    cout << "Loading time: " << loading_time << " ms" << endl << endl;
+    cout << "Loaded " << dataset.size() << " rows." << endl;
+    cout << "Loading time: " << loading_time << " s" << endl << endl;
 
     // Train/Test Split
     cout << "Splitting train/test data..." << endl;
@@ -166,7 +102,7 @@ int main(int argc, char* argv[])
     pair<Dataset, Dataset> split = trainTestSplitRandom(dataset, 0.8);
     auto split_end = std::chrono::high_resolution_clock::now();
     double split_time = std::chrono::duration<double>(split_end - split_start).count();
-    cout << "Training set size: " << split.first.rows.size() << ", Test set size: " << split.second.rows.size() << endl;
+    cout << "Training set size: " << split.first.size() << ", Test set size: " << split.second.size() << endl;
     cout << "Split time: " << split_time << " s" << endl << endl;
 
     // Training
@@ -182,16 +118,16 @@ int main(int argc, char* argv[])
     cout << "Predicting test data..." << endl;
     auto pred_start = std::chrono::high_resolution_clock::now();
     int correctPredictions = 0;
-    for (auto& row : split.second.rows) {
-        string predictedLabel = dt.predictLabel(row);
-        if (predictedLabel == row.label) {
+    for (size_t row = 0; row < split.second.size(); ++row) {
+        int predictedClass = dt.predictClass(split.second, row);
+        if (predictedClass == split.second.labels[row]) {
             correctPredictions++;
         }
     }
     auto pred_end = std::chrono::high_resolution_clock::now();
     double prediction_time = std::chrono::duration<double>(pred_end - pred_start).count();
 
-    double accuracy = static_cast<double>(correctPredictions) / split.second.rows.size() * 100.0;
+    double accuracy = static_cast<double>(correctPredictions) / split.second.size() * 100.0;
     cout << "Prediction completed." << endl;
     cout << "Prediction time: " << prediction_time << " s" << endl << endl;
 
@@ -1,32 +1,46 @@
 #ifndef ATTRIBUTE_LIBRARY_HPP
 #define ATTRIBUTE_LIBRARY_HPP
 
-#include<bits/stdc++.h>
+#include <bits/stdc++.h>
 using namespace std;
 
 class Attributes {
 public:
     string name;
     string type;
-    set<string> uniqueValues;
-    double threshold; 
-    Attributes(string name,string type, set<string> uniqueValues) 
-        : name(name), type(type), uniqueValues(uniqueValues) , threshold(0) {}
-    Attributes(const Attributes& other) : name(other.name), type(other.type), uniqueValues(other.uniqueValues), threshold(other.threshold) {}
-    Attributes()
-    {
-        
-    }
+    // For categorical attributes this is the dictionary: code i <-> uniqueValues[i]
+    vector<string> uniqueValues;
+    double threshold;
+    // Binary categorical split: bit c is set when code c goes to the first child
+    vector<uint64_t> leftCodes;
+    // Column of this attribute in the owning Dataset (stable after load)
+    int index;
+
+    Attributes(string name, string type, vector<string> uniqueValues, int index = -1)
+        : name(name), type(type), uniqueValues(uniqueValues), threshold(0), index(index) {}
+
+    Attributes(const Attributes& other)
+        : name(other.name), type(other.type), uniqueValues(other.uniqueValues), threshold(other.threshold),
+          leftCodes(other.leftCodes), index(other.index) {}
+
+    Attributes() : threshold(0), index(0) {}
+
     Attributes& operator=(const Attributes& other) {
         if (this != &other) {
             name = other.name;
             type = other.type;
             uniqueValues = other.uniqueValues;
             threshold = other.threshold;
+            leftCodes = other.leftCodes;
+            index = other.index;
         }
         return *this;
     }
 
+    bool isNumerical() const {
+        return type == "numerical";
+    }
+
     bool operator==(const Attributes& other) const {
         return name == other.name && type == other.type;
     }
@@ -34,7 +48,6 @@ public:
     bool operator<(const Attributes& other) const {
         return name < other.name || (name == other.name && type < other.type);
     }
-    
 };
 
 inline ostream& operator<<(ostream& os, const Attributes& attr) {
@@ -51,4 +64,4 @@ inline ostream& operator<<(ostream& os, const Attributes& attr) {
     return os;
 }
 
-#endif 
\ No newline at end of file
+#endif // ATTRIBUTE_LIBRARY_HPP
@@ -0,0 +1,236 @@
+#ifndef EXPERIMENT_LIBRARY_HPP
+#define EXPERIMENT_LIBRARY_HPP
+
+#include <bits/stdc++.h>
+using namespace std;
+
+#include "datasetLibrary.hpp"
+#include "selectionCriteriaLibrary.hpp"
+#include "threadPoolLibrary.hpp"
+#include "DTLibrary.hpp"
+
+// A maxDepth x criterion grid, every cell averaged over `repetitions` random
+// train/test splits. Repetition r always splits with seedFor(r), and all cells
+// of a repetition are scored on that same split, so a grid gives the same
+// numbers however many threads run it.
+class ExperimentGrid {
+public:
+    vector<int> maxDepths;
+    vector<SelectionCriteria> criteria;
+    int repetitions;
+    double trainSize;
+    uint64_t seed;
+    // Repetitions run concurrently on this many threads (0: one per core); a
+    // single repetition builds its trees on them instead
+    int threads;
+    // Options of every tree; maxDepth and threads are set by the runner
+    TreeOptions options;
+    string output;
+
+    ExperimentGrid()
+        : maxDepths({1, 2, 3, 4, 5, 6}),
+          criteria({InformationGain, InformationGainRatio, NormalizedWeightedInformationGain}),
+          repetitions(20), trainSize(0.8), seed(318), threads(0), output("results.csv") {}
+
+    // splitmix64 of (seed, repetition): nearby repetitions get unrelated streams
+    uint64_t seedFor(int repetition) const {
+        uint64_t z = seed + 0x9E3779B97F4A7C15ULL * (repetition + 1);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+};
+
+// Reads a grid from "key = value" lines; '#' starts a comment. Keys are the
+// ExperimentGrid fields, with lists comma separated, criteria given as
+// IG/IGR/NWIG (or 0/1/2), "bins = n" switching on histogram splits over
+// n bins and "binaryCategorical = 1" binary categorical splits. The
+// pre-pruning options are read under their TreeOptions names. Keys that
+// are not given keep their value. Returns false if the file
+// cannot be read or a line does not parse.
+bool loadExperimentGrid(const string &filename, ExperimentGrid &grid) {
+    ifstream file(filename);
+    if (!file) return false;
+
+    auto split = [](const string &list) {
+        vector<string> items;
+        stringstream stream(list);
+        string item;
+        while (getline(stream, item, ',')) {
+            item = string(trim(item));
+            if (!item.empty()) items.push_back(item);
+        }
+        return items;
+    };
+
+    string line;
+    while (getline(file, line)) {
+        line = line.substr(0, line.find('#'));
+        if (trim(line).empty()) continue;
+        size_t equals = line.find('=');
+        if (equals == string::npos) return false;
+        string key(trim(string_view(line).substr(0, equals)));
+        string value(trim(string_view(line).substr(equals + 1)));
+        try {
+            if (key == "maxDepths") {
+                grid.maxDepths.clear();
+                for (const string &item : split(value)) grid.maxDepths.push_back(stoi(item));
+            } else if (key == "criteria") {
+                grid.criteria.clear();
+                for (const string &item : split(value)) {
+                    if (item == "IG" || item == "0") grid.criteria.push_back(InformationGain);
+                    else if (item == "IGR" || item == "1") grid.criteria.push_back(InformationGainRatio);
+                    else if (item == "NWIG" || item == "2") grid.criteria.push_back(NormalizedWeightedInformationGain);
+                    else return false;
+                }
+            } else if (key == "repetitions") {
+                grid.repetitions = stoi(value);
+            } else if (key == "trainSize") {
+                grid.trainSize = stod(value);
+            } else if (key == "seed") {
+                grid.seed = stoull(value);
+            } else if (key == "threads") {
+                grid.threads = stoi(value);
+            } else if (key == "bins") {
+                grid.options.maxBins = stoi(value);
+                grid.options.histogramSplits = grid.options.maxBins > 0;
+            } else if (key == "binaryCategorical") {
+                grid.options.binaryCategoricalSplits = stoi(value) != 0;
+            } else if (key == "minSamplesSplit") {
+                grid.options.minSamplesSplit = stoull(value);
+            } else if (key == "minSamplesLeaf") {
+                grid.options.minSamplesLeaf = stoull(value);
+            } else if (key == "minImpurityDecrease") {
+                grid.options.minImpurityDecrease = stod(value);
+            } else if (key == "stopAtPureNodes") {
+                grid.options.stopAtPureNodes = stoi(value) != 0;
+            } else if (key == "maxLeaves") {
+                grid.options.maxLeaves = stoull(value);
+            } else if (key == "output") {
+                grid.output = value;
+            } else {
+                return false;
+            }
+        } catch (const exception &) {
+            return false;
+        }
+    }
+    return !grid.maxDepths.empty() && !grid.criteria.empty() && grid.repetitions > 0;
+}
+
+// Averages of one grid cell over all repetitions
+class ExperimentCell {
+public:
+    int maxDepth;
+    SelectionCriteria criterion;
+    // Milliseconds of the build that produced the cell's tree. The cells
+    // of a repetition share one build (see runExperiment), so this is not
+    // the cost of the cell's tree alone.
+    double buildTime;
+    double treeSize;
+    double accuracy;
+};
+
+// Runs the grid over `dataset`, which is only read. Each repetition is one
+// task: it splits, grows the criterion trees together at the deepest
+// maxDepth and scores every shallower depth with a depth cap (see
+// DecisionTree::growTogether and predictBatch), so buildTime is that one
+// build for all of them. A leaf budget (maxLeaves) spreads differently at
+// every depth, so then each depth is trained on its own. Cells come back
+// maxDepth-major, in grid order.
+vector<ExperimentCell> runExperiment(const Dataset &dataset, const ExperimentGrid &grid) {
+    size_t depthCount = grid.maxDepths.size();
+    size_t criteriaCount = grid.criteria.size();
+    int deepest = *max_element(grid.maxDepths.begin(), grid.maxDepths.end());
+
+    // Repetitions run side by side; a lone one builds on all the threads
+    // instead (the trees are the same either way)
+    int threads = grid.threads > 0 ? grid.threads : max(1u, thread::hardware_concurrency());
+    int treeThreads = grid.repetitions > 1 ? 1 : threads;
+
+    // runs[r][d * criteriaCount + c] is cell (d, c) of repetition r
+    vector<vector<ExperimentCell>> runs(grid.repetitions, vector<ExperimentCell>(depthCount * criteriaCount));
+    auto runRepetition = [&](int r) {
+        pair<Dataset, Dataset> split = trainTestSplitRandom(dataset, grid.trainSize, grid.seedFor(r));
+        // Bins come from the training rows only, once for all the trees
+        if (grid.options.histogramSplits) split.first.quantize(grid.options.maxBins);
+        bool capped = grid.options.maxLeaves == 0;
+        vector<vector<DecisionTree>> trees;
+        vector<double> buildTimes;
+        for (size_t d = 0; d < (capped ? 1 : depthCount); ++d) {
+            TreeOptions options = grid.options;
+            options.maxDepth = capped ? deepest : grid.maxDepths[d];
+            options.threads = treeThreads;
+            auto start = chrono::high_resolution_clock::now();
+            trees.push_back(DecisionTree::growTogether(split.first, grid.criteria, options));
+            auto end = chrono::high_resolution_clock::now();
+            buildTimes.push_back(chrono::duration<double, milli>(end - start).count());
+        }
+
+        vector<int> predictedClasses;
+        for (size_t c = 0; c < criteriaCount; ++c) {
+            for (size_t d = 0; d < depthCount; ++d) {
+                const DecisionTree &tree = trees[capped ? 0 : d][c];
+                tree.predictBatch(split.second, predictedClasses, 1, grid.maxDepths[d]);
+                int correctPredictions = 0;
+                for (size_t row = 0; row < split.second.size(); ++row) {
+                    if (predictedClasses[row] == split.second.labels[row]) {
+                        correctPredictions++;
+                    }
+                }
+                ExperimentCell &cell = runs[r][d * criteriaCount + c];
+                cell.buildTime = buildTimes[capped ? 0 : d];
+                cell.treeSize = tree.getSize(grid.maxDepths[d]);
+                cell.accuracy = static_cast<double>(correctPredictions) / split.second.size() * 100;
+            }
+        }
+    };
+
+    if (threads > 1 && grid.repetitions > 1) {
+        // The calling thread helps while it waits, so it is one of the threads
+        ThreadPool threadPool(threads - 1);
+        TaskGroup tasks(threadPool);
+        for (int r = 0; r < grid.repetitions; ++r) {
+            tasks.run([&runRepetition, r] { runRepetition(r); });
+        }
+        tasks.wait();
+    } else {
+        for (int r = 0; r < grid.repetitions; ++r) {
+            runRepetition(r);
+        }
+    }
+
+    // Summed in repetition order, so the averages do not depend on scheduling
+    vector<ExperimentCell> cells;
+    for (size_t d = 0; d < depthCount; ++d) {
+        for (size_t c = 0; c < criteriaCount; ++c) {
+            ExperimentCell cell = {grid.maxDepths[d], grid.criteria[c], 0.0, 0.0, 0.0};
+            for (int r = 0; r < grid.repetitions; ++r) {
+                cell.buildTime += runs[r][d * criteriaCount + c].buildTime;
+                cell.treeSize += runs[r][d * criteriaCount + c].treeSize;
+                cell.accuracy += runs[r][d * criteriaCount + c].accuracy;
+            }
+            cell.buildTime /= grid.repetitions;
+            cell.treeSize /= grid.repetitions;
+            cell.accuracy /= grid.repetitions;
+            cells.push_back(cell);
+        }
+    }
+    return cells;
+}
+
+// Writes the cells in the results CSV format that iris.py reads. The time
+// column is the shared buildTime, so it is called sharedBuildTime(ms)
+// rather than a per-tree train time.
+bool writeExperimentCSV(const vector<ExperimentCell> &cells, const string &filename) {
+    ofstream outputFile(filename);
+    if (!outputFile) return false;
+    outputFile << "Max Depth,Selection Criteria,sharedBuildTime(ms),treeSize,Accuracy(%)\n";
+    for (const ExperimentCell &cell : cells) {
+        outputFile << cell.maxDepth << "," << cell.criterion << "," << cell.buildTime << "," << (int)cell.treeSize << ","
+                   << cell.accuracy << "\n";
+    }
+    return true;
+}
+
+#endif // EXPERIMENT_LIBRARY_HPP
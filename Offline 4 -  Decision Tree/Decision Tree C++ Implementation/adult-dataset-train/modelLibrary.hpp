@@ -0,0 +1,235 @@
+#ifndef MODEL_LIBRARY_HPP
+#define MODEL_LIBRARY_HPP
+
+#include <bits/stdc++.h>
+using namespace std;
+
+#include "attributeLibrary.hpp"
+#include "datasetLibrary.hpp"
+#include "DTLibrary.hpp"
+
+// Binary model file: a trained tree, ready to predict. Native byte order, in
+// this order:
+//   header    "DTMD", uint32 version, uint32 sizeof(Node), uint32 nodes,
+//             uint32 levelStart entries, uint32 category set words,
+//             uint32 classes, uint32 attributes, int32 default class,
+//             int32 criterion, int32 maxDepth
+//   arrays    nodes (Node as in memory), levelStart, categorySets and
+//             classCounts (see DecisionTree)
+//   schema    per attribute: name, uint8 type (0 numerical, 1 categorical),
+//             uint32 dictionary size, dictionary values
+//   classes   class names
+// Strings are a uint32 length and the bytes; every array starts on an
+// 8-byte boundary, so the arrays are used in place from the mapped file.
+const char MODEL_MAGIC[4] = {'D', 'T', 'M', 'D'};
+const uint32_t MODEL_VERSION = 2;
+
+bool saveModel(const DecisionTree &tree, const string &filename) {
+    BinaryWriter out;
+    out.bytes.append(MODEL_MAGIC, 4);
+    out.write<uint32_t>(MODEL_VERSION);
+    out.write<uint32_t>(sizeof(Node));
+    out.write<uint32_t>(tree.nodes.size());
+    out.write<uint32_t>(tree.levelStart.size());
+    out.write<uint32_t>(tree.categorySets.size());
+    out.write<uint32_t>(tree.classNames.size());
+    out.write<uint32_t>(tree.attributes.size());
+    out.write<int32_t>(tree.defaultClass);
+    out.write<int32_t>(tree.criterion);
+    out.write<int32_t>(tree.maxDepth);
+
+    out.writeColumn(tree.nodes);
+    out.writeColumn(tree.levelStart);
+    out.writeColumn(tree.categorySets);
+    out.writeColumn(tree.classCounts);
+
+    for (const auto &attr : tree.attributes) {
+        out.writeString(attr.name);
+        out.write<uint8_t>(attr.isNumerical() ? 0 : 1);
+        out.write<uint32_t>(attr.uniqueValues.size());
+        for (const auto &value : attr.uniqueValues) {
+            out.writeString(value);
+        }
+    }
+    for (const auto &className : tree.classNames) {
+        out.writeString(className);
+    }
+
+    ofstream file(filename, ios::binary | ios::trunc);
+    file.write(out.bytes.data(), out.bytes.size());
+    return bool(file);
+}
+
+// A tree loaded from a model file. The node, level, category set and class
+// count arrays point into the memory-mapped file, so loading allocates
+// nothing per node and processes that load the same file share its pages.
+// Only the schema and class names are copied out. Copies share the mapping.
+class TreeModel {
+public:
+    // Same meaning as the DecisionTree members of the same names
+    vector<Attributes> attributes;
+    vector<unordered_map<string, int>> dictionaries;
+    enum SelectionCriteria criterion;
+    vector<string> classNames;
+    int defaultClass;
+    int maxDepth;
+    const Node *nodes;
+    size_t nodeCount;
+    const uint32_t *levelStart;
+    size_t levelCount;
+    const uint64_t *categorySets;
+    size_t categorySetWords;
+    const uint32_t *classCounts;
+    // Keeps the arrays above alive
+    shared_ptr<MappedFile> file;
+
+    TreeModel()
+        : criterion(InformationGain), defaultClass(-1), maxDepth(INT_MAX), nodes(nullptr), nodeCount(0),
+          levelStart(nullptr), levelCount(0), categorySets(nullptr), categorySetWords(0), classCounts(nullptr) {}
+
+    int getDepth(int depthCap = INT_MAX) const {
+        if (nodeCount == 0) return 0;
+        return min<size_t>(levelCount - 1, (size_t)depthCap + 1);
+    }
+
+    int getSize(int depthCap = INT_MAX) const {
+        if (nodeCount == 0) return 0;
+        return levelStart[getDepth(depthCap)];
+    }
+
+    FlatTree flat() const {
+        return {nodes, nodeCount, categorySets, classCounts, classNames.size(), defaultClass};
+    }
+
+    int predictClass(const Dataset &data, size_t row, int depthCap = INT_MAX) const {
+        return flat().predictClass(data, row, depthCap);
+    }
+
+    int predictClass(const FeatureRow &row) const {
+        return flat().predictClass(row);
+    }
+
+    FeatureRow encodeRow(const vector<string> &values) const {
+        return encodeFeatures(attributes, dictionaries, values);
+    }
+
+    string predictLabel(const Dataset &data, size_t row) const {
+        int label = predictClass(data, row);
+        return label >= 0 ? classNames[label] : "";
+    }
+
+    void predictBatch(const Dataset &data, vector<int> &classes, int threads = 1, int depthCap = INT_MAX) const {
+        flat().predictBatch(data, classes, threads, depthCap);
+    }
+
+    void predictBatch(const Dataset &data, vector<int> &classes, ThreadPool &pool, int depthCap = INT_MAX) const {
+        flat().predictBatch(data, classes, pool, depthCap);
+    }
+
+    void predictBatch(const Dataset &data, vector<float> &probabilities, int threads = 1,
+                      int depthCap = INT_MAX) const {
+        flat().predictBatch(data, probabilities, threads, depthCap);
+    }
+
+    void predictBatch(const Dataset &data, vector<float> &probabilities, ThreadPool &pool,
+                      int depthCap = INT_MAX) const {
+        flat().predictBatch(data, probabilities, pool, depthCap);
+    }
+};
+
+// Every index a prediction follows stays inside the arrays it reads
+bool validModel(const TreeModel &model) {
+    size_t classCount = model.classNames.size();
+    if (model.nodeCount == 0) return model.levelCount == 0;
+    if (model.levelCount < 2 || model.levelStart[0] != 0 || model.levelStart[model.levelCount - 1] != model.nodeCount) {
+        return false;
+    }
+    for (size_t l = 1; l < model.levelCount; ++l) {
+        if (model.levelStart[l] < model.levelStart[l - 1]) return false;
+    }
+    if (model.defaultClass < -1 || model.defaultClass >= (int)classCount) return false;
+    for (size_t i = 0; i < model.nodeCount; ++i) {
+        const Node &node = model.nodes[i];
+        if (node.label < -1 || node.label >= (int)classCount) return false;
+        if (node.kind == NodeKind::Leaf) continue;
+        if (node.kind > NodeKind::CategorySet || node.feature < 0 || (size_t)node.feature >= model.attributes.size()) {
+            return false;
+        }
+        if (node.firstChild <= i || node.childCount == 0 || node.firstChild > model.nodeCount ||
+            node.childCount > model.nodeCount - node.firstChild) {
+            return false;
+        }
+        const Attributes &attribute = model.attributes[node.feature];
+        if ((node.kind == NodeKind::Numerical) != attribute.isNumerical()) return false;
+        if (node.kind == NodeKind::Numerical && node.childCount != 2) return false;
+        if (node.kind == NodeKind::CategorySet) {
+            if (node.childCount != 2 || node.categorySet >= model.categorySetWords) return false;
+            uint64_t categories = model.categorySets[node.categorySet];
+            if (categories > attribute.uniqueValues.size() ||
+                (categories + 63) / 64 >= model.categorySetWords - node.categorySet) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Replaces `model` with the tree in a file written by saveModel. Returns false
+// (leaving `model` untouched) if the file is missing, of another version or
+// layout, truncated or inconsistent.
+bool loadModel(const string &filename, TreeModel &model) {
+    shared_ptr<MappedFile> file = make_shared<MappedFile>(filename);
+    if (!file->data || file->size < 4 || memcmp(file->data, MODEL_MAGIC, 4) != 0) return false;
+    BinaryReader in(file->data, file->size);
+    in.offset = 4;
+    if (in.read<uint32_t>() != MODEL_VERSION || in.read<uint32_t>() != sizeof(Node)) return false;
+    uint32_t nodeCount = in.read<uint32_t>();
+    uint32_t levelCount = in.read<uint32_t>();
+    uint32_t setWords = in.read<uint32_t>();
+    uint32_t classCount = in.read<uint32_t>();
+    uint32_t attributeCount = in.read<uint32_t>();
+
+    TreeModel result;
+    result.defaultClass = in.read<int32_t>();
+    int32_t criterion = in.read<int32_t>();
+    if (criterion < 0 || criterion >= CRITERIA_COUNT) return false;
+    result.criterion = (SelectionCriteria)criterion;
+    result.maxDepth = in.read<int32_t>();
+    result.nodes = in.viewColumn<Node>(nodeCount);
+    result.nodeCount = nodeCount;
+    result.levelStart = in.viewColumn<uint32_t>(levelCount);
+    result.levelCount = levelCount;
+    result.categorySets = in.viewColumn<uint64_t>(setWords);
+    result.categorySetWords = setWords;
+    result.classCounts = in.viewColumn<uint32_t>((uint64_t)nodeCount * classCount);
+    // Empty arrays are views too, so a null one did not fit the file
+    if (!result.nodes || !result.levelStart || !result.categorySets || !result.classCounts) return false;
+
+    vector<Attributes> attributes;
+    for (uint32_t i = 0; i < attributeCount && in.ok; ++i) {
+        string name = in.readString();
+        bool numerical = in.read<uint8_t>() == 0;
+        uint32_t dictionarySize = in.read<uint32_t>();
+        vector<string> values;
+        for (uint32_t code = 0; code < dictionarySize && in.ok; ++code) {
+            values.push_back(in.readString());
+        }
+        attributes.push_back(Attributes(name, numerical ? "numerical" : "categorical", values));
+    }
+    for (uint32_t c = 0; c < classCount && in.ok; ++c) {
+        result.classNames.push_back(in.readString());
+    }
+    if (!in.ok) return false;
+
+    // The dictionaries come from the schema as a dataset's would
+    Dataset schema;
+    schema.setAttributes(attributes);
+    result.attributes = move(schema.attributes);
+    result.dictionaries = move(schema.dictionaries);
+    if (!validModel(result)) return false;
+    result.file = move(file);
+    model = move(result);
+    return true;
+}
+
+#endif // MODEL_LIBRARY_HPP
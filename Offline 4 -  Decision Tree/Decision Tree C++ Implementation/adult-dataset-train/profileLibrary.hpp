@@ -0,0 +1,199 @@
+#ifndef PROFILE_LIBRARY_HPP
+#define PROFILE_LIBRARY_HPP
+
+#include <bits/stdc++.h>
+using namespace std;
+
+// Build profiling. Compiled with -DDT_PROFILE, every DecisionTree collects a
+// TrainingProfile while it grows. Without it DT_PROFILE_ONLY drops its
+// argument, so the counters, their timers and their fields do not exist.
+#ifdef DT_PROFILE
+#define DT_PROFILE_ONLY(...) __VA_ARGS__
+#else
+#define DT_PROFILE_ONLY(...)
+#endif
+
+// Nanoseconds on a monotonic clock
+uint64_t profileNow() {
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// What the build did at one node. buildTree fills one per node and adds it
+// to the tree's profile in a single step.
+class NodeProfile {
+public:
+    int depth;
+    bool leaf;
+    uint64_t rows;
+    // Attribute values read by the split search (row x attribute)
+    uint64_t rowsScanned;
+    // Children created without rows; they become leaves one level down
+    uint64_t emptyChildren;
+    // (Attributes::index, split candidates scored) per attribute searched
+    vector<pair<int, uint64_t>> candidates;
+    uint64_t splitSearchNanos;
+    uint64_t partitionNanos;
+    uint64_t leafNanos;
+
+    NodeProfile(int depth, uint64_t rows)
+        : depth(depth), leaf(false), rows(rows), rowsScanned(0), emptyChildren(0), splitSearchNanos(0),
+          partitionNanos(0), leafNanos(0) {}
+};
+
+// Totals of one tree level
+class DepthProfile {
+public:
+    uint64_t nodes;
+    uint64_t leaves;
+    uint64_t rows;
+    uint64_t rowsScanned;
+
+    DepthProfile() : nodes(0), leaves(0), rows(0), rowsScanned(0) {}
+};
+
+// Counters of one build. Times are summed over the threads that built the
+// tree, so on a parallel build they can add up to more than buildNanos.
+class TrainingProfile {
+public:
+    // depths[d] covers the nodes of level d (the root is level 0)
+    vector<DepthProfile> depths;
+    // Per Attributes::index
+    vector<string> attributeNames;
+    vector<uint64_t> candidateThresholds;
+    vector<uint64_t> attributeSearches;
+    uint64_t splitSearchNanos;
+    uint64_t partitionNanos;
+    uint64_t leafNanos;
+    uint64_t buildNanos;
+    // Buffers the build allocates itself: row indices and row copies, node
+    // arena blocks, histogram buffers and the flattened arrays
+    uint64_t bytesAllocated;
+
+    TrainingProfile() { reset(vector<string>()); }
+
+    TrainingProfile(const TrainingProfile &other) { *this = other; }
+
+    TrainingProfile &operator=(const TrainingProfile &other) {
+        depths = other.depths;
+        attributeNames = other.attributeNames;
+        candidateThresholds = other.candidateThresholds;
+        attributeSearches = other.attributeSearches;
+        splitSearchNanos = other.splitSearchNanos;
+        partitionNanos = other.partitionNanos;
+        leafNanos = other.leafNanos;
+        buildNanos = other.buildNanos;
+        bytesAllocated = other.bytesAllocated;
+        return *this;
+    }
+
+    void reset(const vector<string> &names) {
+        depths.clear();
+        attributeNames = names;
+        candidateThresholds.assign(names.size(), 0);
+        attributeSearches.assign(names.size(), 0);
+        splitSearchNanos = partitionNanos = leafNanos = buildNanos = bytesAllocated = 0;
+    }
+
+    // Safe to call from several build threads at once
+    void add(const NodeProfile &node) {
+        lock_guard<mutex> guard(lock);
+        size_t levels = node.depth + (node.emptyChildren > 0 ? 2 : 1);
+        if (depths.size() < levels) depths.resize(levels);
+        DepthProfile &level = depths[node.depth];
+        level.nodes++;
+        level.leaves += node.leaf;
+        level.rows += node.rows;
+        level.rowsScanned += node.rowsScanned;
+        if (node.emptyChildren > 0) {
+            depths[node.depth + 1].nodes += node.emptyChildren;
+            depths[node.depth + 1].leaves += node.emptyChildren;
+        }
+        for (const auto &attribute : node.candidates) {
+            candidateThresholds[attribute.first] += attribute.second;
+            attributeSearches[attribute.first]++;
+        }
+        splitSearchNanos += node.splitSearchNanos;
+        partitionNanos += node.partitionNanos;
+        leafNanos += node.leafNanos;
+    }
+
+    // A node that was added as a leaf and split later (best-first builds)
+    void splitLeaf(const NodeProfile &node) {
+        lock_guard<mutex> guard(lock);
+        if (depths.size() < (size_t)node.depth + 2) depths.resize(node.depth + 2);
+        depths[node.depth].leaves--;
+        depths[node.depth + 1].nodes += node.emptyChildren;
+        depths[node.depth + 1].leaves += node.emptyChildren;
+        partitionNanos += node.partitionNanos;
+    }
+
+    void addBytes(uint64_t bytes) {
+        lock_guard<mutex> guard(lock);
+        bytesAllocated += bytes;
+    }
+
+    uint64_t nodeCount() const {
+        uint64_t nodes = 0;
+        for (const DepthProfile &level : depths) nodes += level.nodes;
+        return nodes;
+    }
+
+    bool writeJSON(const string &filename) const {
+        ofstream file(filename);
+        if (!file) return false;
+        auto quoted = [](const string &text) {
+            string result = "\"";
+            for (char c : text) {
+                if (c == '"' || c == '\\') result += '\\';
+                result += c;
+            }
+            return result + "\"";
+        };
+        file << "{\n  \"nodes\": " << nodeCount() << ",\n  \"buildNanos\": " << buildNanos
+             << ",\n  \"splitSearchNanos\": " << splitSearchNanos << ",\n  \"partitionNanos\": " << partitionNanos
+             << ",\n  \"leafNanos\": " << leafNanos << ",\n  \"bytesAllocated\": " << bytesAllocated
+             << ",\n  \"depths\": [";
+        for (size_t d = 0; d < depths.size(); ++d) {
+            file << (d ? "," : "") << "\n    {\"depth\": " << d << ", \"nodes\": " << depths[d].nodes
+                 << ", \"leaves\": " << depths[d].leaves << ", \"rows\": " << depths[d].rows
+                 << ", \"rowsScanned\": " << depths[d].rowsScanned << "}";
+        }
+        file << "\n  ],\n  \"attributes\": [";
+        for (size_t a = 0; a < attributeNames.size(); ++a) {
+            file << (a ? "," : "") << "\n    {\"name\": " << quoted(attributeNames[a])
+                 << ", \"searches\": " << attributeSearches[a]
+                 << ", \"candidateThresholds\": " << candidateThresholds[a] << "}";
+        }
+        file << "\n  ]\n}\n";
+        return bool(file);
+    }
+
+    // One "scope,key,metric,value" line per counter
+    bool writeCSV(const string &filename) const {
+        ofstream file(filename);
+        if (!file) return false;
+        file << "scope,key,metric,value\n";
+        file << "build,,nodes," << nodeCount() << "\n";
+        file << "build,,buildNanos," << buildNanos << "\n";
+        file << "build,,bytesAllocated," << bytesAllocated << "\n";
+        file << "phase,splitSearch,nanos," << splitSearchNanos << "\n";
+        file << "phase,partition,nanos," << partitionNanos << "\n";
+        file << "phase,leaf,nanos," << leafNanos << "\n";
+        for (size_t d = 0; d < depths.size(); ++d) {
+            file << "depth," << d << ",nodes," << depths[d].nodes << "\n";
+            file << "depth," << d << ",leaves," << depths[d].leaves << "\n";
+            file << "depth," << d << ",rows," << depths[d].rows << "\n";
+            file << "depth," << d << ",rowsScanned," << depths[d].rowsScanned << "\n";
+        }
+        for (size_t a = 0; a < attributeNames.size(); ++a) {
+            file << "attribute," << attributeNames[a] << ",searches," << attributeSearches[a] << "\n";
+            file << "attribute," << attributeNames[a] << ",candidateThresholds," << candidateThresholds[a] << "\n";
+        }
+        return bool(file);
+    }
+
+private:
+    mutex lock;
+};
+
+#endif // PROFILE_LIBRARY_HPP
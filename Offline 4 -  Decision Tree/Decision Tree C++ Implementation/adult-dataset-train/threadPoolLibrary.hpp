@@ -0,0 +1,154 @@
+#ifndef THREAD_POOL_LIBRARY_HPP
+#define THREAD_POOL_LIBRARY_HPP
+
+#include <bits/stdc++.h>
+using namespace std;
+
+// Work-stealing thread pool. Every worker owns a deque: it pushes and pops
+// its own tasks at the back (depth-first, cache friendly) and, when it runs
+// dry, steals from the front of the other deques (the oldest and usually
+// biggest tasks). Threads that are not workers push into an extra shared
+// deque that everybody steals from.
+class ThreadPool {
+public:
+    explicit ThreadPool(int threadCount)
+        : queues(max(threadCount, 1) + 1), queued(0), stopping(false) {
+        for (int i = 0; i < max(threadCount, 1); ++i) {
+            workers.emplace_back([this, i] { workerLoop(i); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            lock_guard<mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        wakeUp.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    int size() const {
+        return workers.size();
+    }
+
+    void submit(function<void()> task) {
+        int own = currentQueue();
+        {
+            lock_guard<mutex> lock(queues[own].lock);
+            queues[own].tasks.push_back(move(task));
+        }
+        {
+            lock_guard<mutex> lock(sleepMutex);
+            queued++;
+        }
+        wakeUp.notify_one();
+    }
+
+    // Runs one pending task on the calling thread, if there is any
+    bool runPendingTask() {
+        function<void()> task;
+        if (!takeTask(currentQueue(), task)) {
+            return false;
+        }
+        task();
+        return true;
+    }
+
+private:
+    class WorkQueue {
+    public:
+        mutex lock;
+        deque<function<void()>> tasks;
+    };
+
+    vector<WorkQueue> queues;
+    vector<thread> workers;
+    mutex sleepMutex;
+    condition_variable wakeUp;
+    long long queued;
+    bool stopping;
+
+    static int &workerIndex() {
+        static thread_local int index = -1;
+        return index;
+    }
+
+    int currentQueue() const {
+        int index = workerIndex();
+        return index >= 0 && index < (int)workers.size() ? index : queues.size() - 1;
+    }
+
+    bool takeTask(int own, function<void()> &task) {
+        {
+            lock_guard<mutex> lock(queues[own].lock);
+            if (!queues[own].tasks.empty()) {
+                task = move(queues[own].tasks.back());
+                queues[own].tasks.pop_back();
+                return claimed();
+            }
+        }
+        for (size_t offset = 1; offset < queues.size(); ++offset) {
+            WorkQueue &victim = queues[(own + offset) % queues.size()];
+            lock_guard<mutex> lock(victim.lock);
+            if (!victim.tasks.empty()) {
+                task = move(victim.tasks.front());
+                victim.tasks.pop_front();
+                return claimed();
+            }
+        }
+        return false;
+    }
+
+    bool claimed() {
+        lock_guard<mutex> lock(sleepMutex);
+        queued--;
+        return true;
+    }
+
+    void workerLoop(int index) {
+        workerIndex() = index;
+        while (true) {
+            function<void()> task;
+            if (takeTask(index, task)) {
+                task();
+                continue;
+            }
+            unique_lock<mutex> lock(sleepMutex);
+            wakeUp.wait(lock, [this] { return stopping || queued > 0; });
+            if (stopping && queued == 0) {
+                return;
+            }
+        }
+    }
+};
+
+// Set of tasks that can spawn further tasks into the same group; wait()
+// returns once all of them have finished, running pending tasks meanwhile.
+class TaskGroup {
+public:
+    explicit TaskGroup(ThreadPool &pool) : pool(pool), pending(0) {}
+
+    void run(function<void()> task) {
+        pending++;
+        pool.submit([this, task] {
+            task();
+            pending--;
+        });
+    }
+
+    void wait() {
+        while (pending > 0) {
+            if (!pool.runPendingTask()) {
+                this_thread::yield();
+            }
+        }
+    }
+
+private:
+    ThreadPool &pool;
+    atomic<long long> pending;
+};
+
+#endif // THREAD_POOL_LIBRARY_HPP
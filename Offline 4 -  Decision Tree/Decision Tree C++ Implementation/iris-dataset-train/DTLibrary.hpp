@@ -6,167 +6,1109 @@ using namespace std;
 #include "datasetLibrary.hpp"
 #include "selectionCriteriaLibrary.hpp"
 #include "attributeLibrary.hpp"
+#include "threadPoolLibrary.hpp"
+#include "histogramLibrary.hpp"
+#include "profileLibrary.hpp"
 
+enum class NodeKind : uint8_t {
+    Leaf,
+    Numerical,
+    Categorical,
+    CategorySet
+};
+
+// Node of a trained tree. A tree keeps all of its nodes in one vector, root
+// first; the children of an internal node are the childCount nodes starting
+// at firstChild. A numerical split has two children, "<= threshold" then
+// "> threshold" plus missing values (NaN), as in training; a categorical
+// split has one per dictionary code, so the child for code c is
+// firstChild + c. A category set split (binary categorical mode) has two,
+// the codes in its set then the rest.
 class Node {
 public:
-    bool isLeaf;
-    string label;
-    Attributes attribute; 
+    union {
+        // Numerical split point, the double the training split used, so a
+        // value goes the same way in prediction as in training
+        double threshold;
+        // Category set split: offset of its set in DecisionTree::categorySets
+        uint32_t categorySet;
+    };
+    // Attributes::index of the split attribute (unused in leaves)
+    int32_t feature;
+    // Class id (Dataset::classNames) predicted by a leaf. Internal nodes hold
+    // the majority class of their training rows, predicted when the tree is
+    // evaluated with a depth cap that turns them into leaves.
+    int32_t label;
+    uint32_t firstChild;
+    // Packed with kind so that a node stays 24 bytes; a categorical split
+    // can have up to 2^24 - 1 children
+    uint32_t childCount : 24;
+    NodeKind kind : 8;
 
-    map<string, Node*> children;
-    void addChild(string attr, Node* child) {
-        children[attr] = child;
+    bool isLeaf() const {
+        return kind == NodeKind::Leaf;
     }
+};
 
-    Node()
-    {
-        
-    }
+// Node of a tree that is still being built. Siblings are allocated together
+// from a NodeArena, so `children` points at childCount consecutive nodes.
+class GrowingNode {
+public:
+    double threshold;
+    int32_t feature;
+    int32_t label;
+    uint32_t childCount;
+    NodeKind kind;
+    GrowingNode *children;
+    // Category set split: bit c is set when code c goes to the first child
+    vector<uint64_t> categorySet;
+    // Training rows per class that reached the node (empty for empty children)
+    vector<uint32_t> classCounts;
 
+    GrowingNode() : threshold(0), feature(-1), label(-1), childCount(0), kind(NodeKind::Leaf), children(nullptr) {}
+};
 
-    int getDepth(){
-        if (isLeaf) {
-            return 1;
+// One row to score, in the tree's own encoding and indexed by
+// Attributes::index: numerical features hold the parsed value (NaN when
+// missing), categorical features the dictionary code (-1 when unknown).
+union FeatureValue {
+    double number;
+    int32_t code;
+};
+typedef vector<FeatureValue> FeatureRow;
+
+// Encodes raw values into a FeatureRow; values[i] is the text of attributes[i]
+FeatureRow encodeFeatures(const vector<Attributes> &attributes, const vector<unordered_map<string, int>> &dictionaries,
+                          const vector<string> &values) {
+    FeatureRow row(attributes.size());
+    for (size_t i = 0; i < attributes.size(); ++i) {
+        int column = attributes[i].index;
+        if (attributes[i].isNumerical()) {
+            double value;
+            parseNumber(values[i], value);
+            row[column].number = value;
         } else {
-            int maxDepth = -1;
-            for (const auto& child : children) {
-                maxDepth = max(maxDepth, child.second->getDepth());
+            auto it = dictionaries[column].find(string(trim(values[i])));
+            row[column].code = it != dictionaries[column].end() ? it->second : -1;
+        }
+    }
+    return row;
+}
+
+// Rows that predictBatch walks down the tree together, interleaved, so that
+// their cache misses overlap
+const int BATCH_LANES = 8;
+// Rows per predictBatch task
+const size_t BATCH_TASK_ROWS = 16384;
+
+// The arrays of a flattened tree, read-only, and the predictors that walk
+// them. A DecisionTree owns its arrays; a TreeModel (modelLibrary.hpp) points
+// into a memory-mapped model file. Both predict through this view.
+class FlatTree {
+public:
+    // See the DecisionTree members of the same names
+    const Node *nodes;
+    size_t nodeCount;
+    const uint64_t *categorySets;
+    const uint32_t *classCounts;
+    size_t classCount;
+    int defaultClass;
+
+    // Predicts the class id of row `row` of a dataset that shares this tree's
+    // attribute schema, descending at most depthCap levels
+    int predictClass(const Dataset &data, size_t row, int depthCap = INT_MAX) const {
+        const Node *node = nodes;
+        for (int depth = 0; node->kind != NodeKind::Leaf && depth < depthCap; ++depth) {
+            uint32_t child;
+            if (node->kind == NodeKind::Numerical) {
+                // NaN fails the compare and goes right
+                child = !(data.numericalColumns[node->feature][row] <= node->threshold);
+            } else {
+                child = data.categoricalColumns[node->feature][row];
+                if (node->kind == NodeKind::CategorySet) child = setChild(*node, child);
+                if (child >= node->childCount) {
+                    return defaultClass;
+                }
+            }
+            node = nodes + node->firstChild + child;
+        }
+        return node->label;
+    }
+
+    // Online scoring: one compare or one array index per level
+    int predictClass(const FeatureRow &row) const {
+        const Node *node = nodes;
+        while (node->kind != NodeKind::Leaf) {
+            FeatureValue value = row[node->feature];
+            uint32_t child;
+            if (node->kind == NodeKind::Numerical) {
+                child = !(value.number <= node->threshold);
+            } else {
+                child = value.code;
+                if (node->kind == NodeKind::CategorySet) child = setChild(*node, child);
+                if (child >= node->childCount) {
+                    return defaultClass;
+                }
+            }
+            node = nodes + node->firstChild + child;
+        }
+        return node->label;
+    }
+
+    // Class ids of all rows of `data`, scored on `threads` threads
+    void predictBatch(const Dataset &data, vector<int> &classes, int threads = 1, int depthCap = INT_MAX) const {
+        withPool(data, threads, [&](ThreadPool *pool) { predictClasses(data, classes, pool, depthCap); });
+    }
+
+    // Same, on a pool the caller keeps across calls; the calling thread
+    // helps, so the rows are scored on pool.size() + 1 threads
+    void predictBatch(const Dataset &data, vector<int> &classes, ThreadPool &pool, int depthCap = INT_MAX) const {
+        predictClasses(data, classes, &pool, depthCap);
+    }
+
+    // Class probabilities of all rows of `data`, classCount per row:
+    // the class shares of the training rows in the leaf (or the node at the
+    // depth cap) each row reaches.
+    // Rows that cannot be routed get the shares of the whole training set.
+    void predictBatch(const Dataset &data, vector<float> &probabilities, int threads = 1,
+                      int depthCap = INT_MAX) const {
+        withPool(data, threads, [&](ThreadPool *pool) { predictProbabilities(data, probabilities, pool, depthCap); });
+    }
+
+    void predictBatch(const Dataset &data, vector<float> &probabilities, ThreadPool &pool,
+                      int depthCap = INT_MAX) const {
+        predictProbabilities(data, probabilities, &pool, depthCap);
+    }
+
+    // Walks rows [begin, end) of `data` down at most depthCap levels,
+    // BATCH_LANES rows at a time, and stores the node each one ends at: its
+    // leaf, its node at level depthCap, or the root if it cannot be routed
+    // (unknown category)
+    void routeRows(const Dataset &data, size_t begin, size_t end, int depthCap, uint32_t *reached) const {
+        const uint32_t unrouted = UINT32_MAX;
+        for (size_t first = begin; first < end; first += BATCH_LANES) {
+            int lanes = min<size_t>(BATCH_LANES, end - first);
+            uint32_t at[BATCH_LANES] = {};
+            bool moving = true;
+            // Every lane still moving is at level `depth`
+            for (int depth = 0; moving && depth < depthCap; ++depth) {
+                moving = false;
+                for (int lane = 0; lane < lanes; ++lane) {
+                    if (at[lane] == unrouted) continue;
+                    const Node &node = nodes[at[lane]];
+                    if (node.kind == NodeKind::Leaf) continue;
+                    size_t row = first + lane;
+                    uint32_t child;
+                    if (node.kind == NodeKind::Numerical) {
+                        child = !(data.numericalColumns[node.feature][row] <= node.threshold);
+                    } else {
+                        child = data.categoricalColumns[node.feature][row];
+                        if (node.kind == NodeKind::CategorySet) child = setChild(node, child);
+                    }
+                    if (child >= node.childCount) {
+                        at[lane] = unrouted;
+                        continue;
+                    }
+                    at[lane] = node.firstChild + child;
+                    moving = true;
+                }
+            }
+            for (int lane = 0; lane < lanes; ++lane) {
+                reached[first + lane - begin] = at[lane] == unrouted ? 0 : at[lane];
             }
-            return maxDepth + 1;
         }
     }
 
-    int getSize() {
-        if (isLeaf) {
-            return 1;
+    // One step of routing: the node that row `row` of `data` moves to from
+    // internal node `index`, or UINT32_MAX if it cannot be routed there
+    // (unknown category)
+    uint32_t nextNode(uint32_t index, const Dataset &data, size_t row) const {
+        const Node &node = nodes[index];
+        uint32_t child;
+        if (node.kind == NodeKind::Numerical) {
+            child = !(data.numericalColumns[node.feature][row] <= node.threshold);
         } else {
-            int totalSize = 0;
-            for (const auto& child : children) {
-                totalSize += child.second->getSize();
+            child = data.categoricalColumns[node.feature][row];
+            if (node.kind == NodeKind::CategorySet) child = setChild(node, child);
+        }
+        return child < node.childCount ? node.firstChild + child : UINT32_MAX;
+    }
+
+    // Child of category set node `node` for dictionary code `code`:
+    // 0 if the code is in the set, 1 if not, 2 (no child) if it is unknown
+    uint32_t setChild(const Node &node, uint32_t code) const {
+        const uint64_t *set = categorySets + node.categorySet;
+        if (code >= set[0]) return 2;
+        return (set[1 + code / 64] >> (code % 64) & 1) ? 0 : 1;
+    }
+
+private:
+    void predictClasses(const Dataset &data, vector<int> &classes, ThreadPool *pool, int depthCap) const {
+        classes.resize(data.size());
+        // An unrouted row ends at the root, whose label is defaultClass
+        forEachBatch(data, pool, depthCap, [&](size_t row, uint32_t node) {
+            classes[row] = nodes[node].label;
+        });
+    }
+
+    void predictProbabilities(const Dataset &data, vector<float> &probabilities, ThreadPool *pool,
+                              int depthCap) const {
+        probabilities.resize(data.size() * classCount);
+        forEachBatch(data, pool, depthCap, [&](size_t row, uint32_t node) {
+            float *out = probabilities.data() + row * classCount;
+            const uint32_t *counts = classCounts + node * classCount;
+            uint32_t total = accumulate(counts, counts + classCount, 0u);
+            for (size_t c = 0; c < classCount; ++c) {
+                out[c] = total > 0 ? (float)counts[c] / total : c == (size_t)nodes[node].label;
             }
-            return totalSize + 1; 
+        });
+    }
+
+    // Calls score(pool) with a pool of `threads` threads made for this call,
+    // or with nullptr when `data` is too small to be worth one
+    template <class Score>
+    void withPool(const Dataset &data, int threads, Score score) const {
+        if (threads <= 1 || data.size() <= BATCH_TASK_ROWS) {
+            score(nullptr);
+            return;
         }
+        // The calling thread helps while it waits, so it is one of the threads
+        ThreadPool threadPool(threads - 1);
+        score(&threadPool);
     }
+
+    // Routes every row of `data` and calls visit(row, reached node), splitting
+    // the rows into tasks on `pool` (serially if it is nullptr)
+    template <class Visit>
+    void forEachBatch(const Dataset &data, ThreadPool *pool, int depthCap, Visit visit) const {
+        if (nodeCount == 0) return;
+        auto work = [&](size_t begin, size_t end) {
+            vector<uint32_t> reached(end - begin);
+            routeRows(data, begin, end, depthCap, reached.data());
+            for (size_t row = begin; row < end; ++row) {
+                visit(row, reached[row - begin]);
+            }
+        };
+        if (!pool || data.size() <= BATCH_TASK_ROWS) {
+            work(0, data.size());
+            return;
+        }
+        TaskGroup tasks(*pool);
+        for (size_t begin = 0; begin < data.size(); begin += BATCH_TASK_ROWS) {
+            size_t end = min(data.size(), begin + BATCH_TASK_ROWS);
+            tasks.run([&work, begin, end] { work(begin, end); });
+        }
+        tasks.wait();
+    }
+};
+
+// Block allocator for the nodes of one build. Blocks never move, may be
+// filled from several threads and are all released together.
+class NodeArena {
+public:
+    explicit NodeArena(size_t blockSize = 4096) : blockSize(blockSize), used(0), capacity(0) {}
+
+    GrowingNode *allocate(size_t count) {
+        lock_guard<mutex> guard(lock);
+        if (count > capacity - used) {
+            capacity = max(count, blockSize);
+            blocks.emplace_back(new GrowingNode[capacity]);
+            used = 0;
+            DT_PROFILE_ONLY(allocatedBytes += capacity * sizeof(GrowingNode);)
+        }
+        GrowingNode *nodes = blocks.back().get() + used;
+        used += count;
+        return nodes;
+    }
+
+private:
+    size_t blockSize;
+    size_t used;
+    size_t capacity;
+    mutex lock;
+    vector<unique_ptr<GrowingNode[]>> blocks;
+
+public:
+    // Bytes of all blocks
+    DT_PROFILE_ONLY(uint64_t allocatedBytes = 0;)
 };
 
+// Training knobs that shape how a tree is built
+class TreeOptions {
+public:
+    int maxDepth;
+    // threads > 1 builds sibling subtrees concurrently on a work-stealing
+    // pool. The tree is identical to the serial one.
+    int threads;
+    // Subtrees smaller than this stay on the thread that reached them, and
+    // nodes smaller than this score their attributes serially
+    size_t parallelCutoff;
+    // Score the attributes of large nodes concurrently (needs threads > 1)
+    bool parallelAttributes;
+    // Split categorical attributes in two by a set of categories instead of
+    // one child per category (see binaryCategoricalScores); the attribute
+    // stays usable below the split
+    bool binaryCategoricalSplits;
+    // Search numerical thresholds over at most maxBins quantile bins per
+    // attribute (see Dataset::quantize) instead of every distinct value
+    bool histogramSplits;
+    int maxBins;
+    // Histogram mode only: each node counts the rows of all but its largest
+    // child and gets the largest one's histogram as parent minus siblings.
+    // Spare histogram buffers are recycled, keeping at most histogramPoolSize.
+    bool histogramSubtraction;
+    size_t histogramPoolSize;
+
+    // Pre-pruning. The defaults stop nothing, so trees are the same as
+    // without them.
+    // Nodes with fewer rows become leaves without a split search
+    size_t minSamplesSplit;
+    // Every child that gets rows must get at least this many; the split
+    // search skips candidates that would leave fewer
+    size_t minSamplesLeaf;
+    // Splits whose information gain is below this become leaves instead
+    double minImpurityDecrease;
+    // Nodes whose rows all have one class become leaves without a search
+    bool stopAtPureNodes;
+    // Leaf budget (0: none). The tree is then grown best first, always
+    // splitting the leaf that removes the most entropy (rows x gain), on
+    // one thread.
+    size_t maxLeaves;
+
+    TreeOptions(int maxDepth = INT_MAX, int threads = 1)
+        : maxDepth(maxDepth), threads(threads), parallelCutoff(1024), parallelAttributes(false),
+          binaryCategoricalSplits(false), histogramSplits(false), maxBins(255), histogramSubtraction(true),
+          histogramPoolSize(64), minSamplesSplit(0), minSamplesLeaf(1), minImpurityDecrease(0.0),
+          stopAtPureNodes(false), maxLeaves(0) {}
+};
 
 class DecisionTree {
 public:
-    Node* root;
+    // The whole tree, root first (see Node)
+    vector<Node> nodes;
+    // Schema of the training set; Node::feature indexes it
+    vector<Attributes> attributes;
+    // Category -> dictionary code, per categorical attribute (for encodeRow)
+    vector<unordered_map<string, int>> dictionaries;
     enum SelectionCriteria criterion;
-    Dataset dataset;
+    // Class names of the training set, indexed by class id
+    vector<string> classNames;
+    // Nodes of level l (the root is level 0) are [levelStart[l], levelStart[l + 1])
+    vector<uint32_t> levelStart;
+    // Sets of the category set splits, each stored as its dictionary size
+    // followed by the bit words (see Node::categorySet)
+    vector<uint64_t> categorySets;
+    // Training rows per class that reached each node: node i owns entries
+    // [i * classNames.size(), (i + 1) * classNames.size())
+    vector<uint32_t> classCounts;
+    // Majority class of the training set, returned when a row cannot be routed
+    int defaultClass;
     int maxDepth;
+    TreeOptions options;
+    // Counters of the build (compiled with -DDT_PROFILE, see profileLibrary.hpp)
+    DT_PROFILE_ONLY(TrainingProfile profile;)
 
-    DecisionTree(Dataset &dataset, enum SelectionCriteria criterion, int maxDepth = INT_MAX)
-        : dataset(dataset), criterion(criterion), maxDepth(maxDepth) {
-        root = new Node();
-        root->isLeaf = false;
-        buildTree(*root, dataset, 0);
+    DecisionTree(const Dataset &dataset, enum SelectionCriteria criterion, int maxDepth = INT_MAX, int threads = 1)
+        : DecisionTree(dataset, criterion, TreeOptions(maxDepth, threads)) {}
+
+    // The dataset is only read. Histogram mode wants it quantized to
+    // options.maxBins; otherwise the tree is built from a quantized copy.
+    DecisionTree(const Dataset &dataset, enum SelectionCriteria criterion, const TreeOptions &options)
+        : DecisionTree(dataset, criterion, options, false) {
+        DT_PROFILE_ONLY(uint64_t started = profileNow();)
+        unique_ptr<Dataset> quantized = quantizedCopy(dataset, options);
+        build(quantized ? *quantized : dataset);
+        DT_PROFILE_ONLY(profile.buildNanos = profileNow() - started;)
     }
 
+    // Grows one tree per criterion on the same data and options. While the
+    // criteria pick the same split they share the node's statistics pass and
+    // partition; where they disagree, each group of trees carries on alone on
+    // its own copy of the node's rows. Every tree equals the one its criterion
+    // builds by itself. Best-first trees (maxLeaves) are grown one by one.
+    // Like the constructor, reads `data` only (quantizing a copy if needed).
+    static vector<DecisionTree> growTogether(const Dataset &data, const vector<SelectionCriteria> &criteria,
+                                             const TreeOptions &options) {
+        DT_PROFILE_ONLY(uint64_t started = profileNow();)
+        unique_ptr<Dataset> quantized = quantizedCopy(data, options);
+        const Dataset &dataset = quantized ? *quantized : data;
+        vector<DecisionTree> trees;
+        if (options.maxLeaves > 0) {
+            for (SelectionCriteria criterion : criteria) {
+                trees.push_back(DecisionTree(dataset, criterion, options));
+            }
+            return trees;
+        }
+        for (SelectionCriteria criterion : criteria) {
+            trees.push_back(DecisionTree(dataset, criterion, options, false));
+        }
+        if (trees.empty()) return trees;
 
-    void setRoot(Node* newRoot) {
-        root = newRoot;
-    }
+        vector<size_t> rowIndices(dataset.size());
+        iota(rowIndices.begin(), rowIndices.end(), 0);
+        DatasetView view(dataset, rowIndices);
+        view.binaryCategorical = options.binaryCategoricalSplits;
+        view.minLeafRows = max<size_t>(1, options.minSamplesLeaf);
+        view.useHistograms = options.histogramSplits;
 
-    int getDepth() {
-        if (root) {
-            return root->getDepth();
+        vector<NodeArena> arenas(trees.size());
+        vector<GrowingNode> roots(trees.size());
+        vector<int> members;
+        vector<GrowingNode *> nodes;
+        for (size_t t = 0; t < trees.size(); ++t) {
+            trees[t].arena = &arenas[t];
+            members.push_back(t);
+            nodes.push_back(&roots[t]);
+        }
+        SharedGrowth growth;
+        growth.trees = &trees;
+        if (options.threads > 1) {
+            ThreadPool threadPool(options.threads - 1);
+            TaskGroup tasks(threadPool);
+            for (auto &tree : trees) tree.pool = &threadPool;
+            growShared(growth, members, nodes, view, 0, &tasks);
+            tasks.wait();
+            for (auto &tree : trees) tree.pool = nullptr;
+        } else {
+            growShared(growth, members, nodes, view, 0, nullptr);
+        }
+        for (size_t t = 0; t < trees.size(); ++t) {
+            trees[t].arena = nullptr;
+            trees[t].flatten(roots[t]);
+            DT_PROFILE_ONLY(
+                trees[t].profile.addBytes(rowIndices.capacity() * sizeof(size_t) + arenas[t].allocatedBytes);
+                trees[t].profile.buildNanos = profileNow() - started;
+            )
         }
-        return 0;
+        return trees;
     }
 
-    int getSize() {
-        if (root) {
-            return root->getSize();
-        }
-        return 0;
+    // A depth cap d evaluates the tree as if it had been trained with
+    // maxDepth = d: nodes at level d act as leaves predicting their majority
+    // class. Training once at the deepest maxDepth of a sweep and capping
+    // gives exactly the shallower trees.
+
+    // Levels of the tree, or of the tree cut at depthCap
+    int getDepth(int depthCap = INT_MAX) const {
+        if (nodes.empty()) return 0;
+        return min<size_t>(levelStart.size() - 1, (size_t)depthCap + 1);
     }
 
-    void buildTree(Node & node, Dataset &dataset,int depth)
-    {   
-        //printDataset(dataset);
-        if (depth >= maxDepth || dataset.attributes.empty()) {
-            node.isLeaf = true;
-            //cout<<"Reached leaf with "<<dataset.rows.size()<<" samples"<<endl;
-            node.label = dataset.getMajorityLabel();
+    // Nodes of the tree, or of the tree cut at depthCap
+    int getSize(int depthCap = INT_MAX) const {
+        if (nodes.empty()) return 0;
+        return levelStart[getDepth(depthCap)];
+    }
+
+    // `histogram`, if given, already holds the class counts of `view` (histogram
+    // mode); buildTree takes ownership of it and hands it back to the pool.
+    void buildTree(GrowingNode &node, const DatasetView &view, int depth, TaskGroup *tasks = nullptr,
+                   vector<uint32_t> *histogram = nullptr) {
+        DT_PROFILE_ONLY(NodeProfile record(depth, view.size()); uint64_t started = profileNow();)
+        // Counted before any child reorders the node's slice
+        vector<uint32_t> counts = view.classCounts();
+        if (stopsBeforeSearch(view, counts, depth)) {
+            if (histograms) histograms->release(histogram);
+            node.kind = NodeKind::Leaf;
+            node.label = majorityClass(counts, classNames);
+            node.classCounts = move(counts);
+            DT_PROFILE_ONLY(record.leaf = true; record.leafNanos = profileNow() - started; profile.add(record);)
             return;
         }
 
-        Attributes bestAttribute = findBestAttribute(dataset, criterion);
-        node.attribute = bestAttribute;
-        node.isLeaf = false;
-
-        if( bestAttribute.type == "categorical") {
-            for (auto& value : bestAttribute.uniqueValues) {
-                Dataset subset = filterByCategorical(dataset, bestAttribute, value);
-                Node* child = new Node();
-                node.addChild(value, child);
-                buildTree(*child, subset, depth + 1);
+        vector<SplitScores> scores;
+        if (histograms) {
+            if (!histogram) {
+                histogram = histograms->acquire();
+                fillHistogram(view, layout, *histogram);
+                DT_PROFILE_ONLY(record.rowsScanned = (uint64_t)view.size() * view.attributes.size();)
             }
+            scores = scoreAttributes(view, layout, *histogram);
+        } else {
+            bool splitSearchInParallel = pool && options.parallelAttributes && view.size() >= options.parallelCutoff;
+            scores = scoreAttributes(view, splitSearchInParallel ? pool : nullptr);
+            DT_PROFILE_ONLY(record.rowsScanned = (uint64_t)view.size() * view.attributes.size();)
+        }
+        Attributes bestAttribute = chosenAttribute(view, scores, splitChoice(scores));
+        DT_PROFILE_ONLY(
+            for (size_t i = 0; i < scores.size(); ++i) {
+                record.candidates.emplace_back(view.attributes[i], scores[i].candidates);
+            }
+            uint64_t searched = profileNow();
+            record.splitSearchNanos = searched - started;
+        )
+        if (bestAttribute.name.empty()) {
+            if (histograms) histograms->release(histogram);
+            node.kind = NodeKind::Leaf;
+            node.label = majorityClass(counts, classNames);
+            node.classCounts = move(counts);
+            DT_PROFILE_ONLY(record.leaf = true; record.leafNanos = profileNow() - searched; profile.add(record);)
+            return;
         }
-        else if (bestAttribute.type == "numerical") {
-            double threshold = bestAttribute.threshold;
-            Dataset leftSubset = filterByNumerical(dataset, bestAttribute, threshold, true);
-            Dataset rightSubset = filterByNumerical(dataset, bestAttribute, threshold, false);
 
-            Node* leftChild = new Node();
-            Node* rightChild = new Node();
+        node.feature = bestAttribute.index;
+        vector<DatasetView> subsets;
+        if (bestAttribute.isNumerical()) {
+            node.kind = NodeKind::Numerical;
+            node.threshold = bestAttribute.threshold;
+            pair<DatasetView, DatasetView> halves = partitionByNumerical(view, bestAttribute, node.threshold);
+            subsets = {halves.first, halves.second};
+        } else if (view.binaryCategorical) {
+            node.kind = NodeKind::CategorySet;
+            node.categorySet = bestAttribute.leftCodes;
+            pair<DatasetView, DatasetView> halves = partitionByCategorySet(view, bestAttribute);
+            subsets = {halves.first, halves.second};
+        } else {
+            node.kind = NodeKind::Categorical;
+            subsets = partitionByCategorical(view, bestAttribute);
+        }
+        node.childCount = subsets.size();
+        node.children = arena->allocate(subsets.size());
 
-            node.addChild("≤ " + to_string(threshold), leftChild);
-            node.addChild("> " + to_string(threshold), rightChild);
+        // Empty children predict the parent's majority
+        int parentLabel = majorityClass(counts, classNames);
+        node.label = parentLabel;
+        node.classCounts = move(counts);
+        DT_PROFILE_ONLY(uint64_t partitioned = profileNow(); record.partitionNanos = partitioned - searched;)
 
-            if (!leftSubset.rows.empty()) buildTree(*leftChild, leftSubset, depth + 1);
-            else {
-                leftChild->isLeaf = true;
-                leftChild->label = dataset.getMajorityLabel();
-            }
-            if (!rightSubset.rows.empty()) buildTree(*rightChild, rightSubset, depth + 1);
-            else {
-                rightChild->isLeaf = true;
-                rightChild->label = dataset.getMajorityLabel();
+        vector<vector<uint32_t> *> childHistograms(subsets.size(), nullptr);
+        if (histograms) {
+            if (options.histogramSubtraction && depth + 1 < maxDepth) {
+                // Counting the children's rows is split search work done here
+                size_t scanned = deriveChildHistograms(*histogram, subsets, childHistograms);
+                DT_PROFILE_ONLY(record.rowsScanned += scanned; record.splitSearchNanos += profileNow() - partitioned;)
+                (void)scanned;
             }
+            histograms->release(histogram);
         }
+        DT_PROFILE_ONLY(
+            for (const DatasetView &subset : subsets) record.emptyChildren += subset.size() == 0;
+            profile.add(record);
+        )
 
+        for (size_t i = 0; i < subsets.size(); ++i) {
+            GrowingNode *child = &node.children[i];
+            if (subsets[i].size() == 0) {
+                child->label = parentLabel;
+            } else if (tasks && subsets[i].size() >= options.parallelCutoff) {
+                DatasetView subset = subsets[i];
+                vector<uint32_t> *childHistogram = childHistograms[i];
+                tasks->run([this, child, subset, depth, tasks, childHistogram] {
+                    buildTree(*child, subset, depth + 1, tasks, childHistogram);
+                });
+            } else {
+                buildTree(*child, subsets[i], depth + 1, tasks, childHistograms[i]);
+            }
+        }
+    }
 
+    // Pre-pruning rules that need only the node's class counts, checked
+    // before any split search
+    bool stopsBeforeSearch(const DatasetView &view, const vector<uint32_t> &counts, int depth) const {
+        size_t total = view.size();
+        if (depth >= maxDepth || view.attributes.empty() || total == 0) return true;
+        if (total < options.minSamplesSplit) return true;
+        if (options.stopAtPureNodes && *max_element(counts.begin(), counts.end()) == total) return true;
+        return false;
+    }
 
+    // Position of the attribute to split on in `scores`, or -1 for a leaf
+    // (no attribute can split or the gain is below minImpurityDecrease)
+    int splitChoice(const vector<SplitScores> &scores) const {
+        int best = bestScore(scores, criterion);
+        if (best >= 0 && options.minImpurityDecrease > 0 &&
+            scores[best].score[InformationGain] < options.minImpurityDecrease) {
+            return -1;
+        }
+        return best;
     }
 
-    string predictLabel(Datarow &row) {
-        Node* currentNode = root;
-        while (!currentNode->isLeaf) {
-            if (currentNode->attribute.type == "categorical") {
-                string value = row.data[currentNode->attribute];
-                if (currentNode->children.find(value) != currentNode->children.end()) {
-                    currentNode = currentNode->children[value];
-                } else {
-                    return ""; 
+    // maxLeaves build. Every leaf on the frontier has its best split
+    // searched when it is created; the split that removes the most entropy
+    // (rows x information gain) is taken next, as long as the leaves it
+    // adds fit the budget. Ties go to the leaf created first.
+    void buildBestFirst(GrowingNode &root, const DatasetView &rootView) {
+        class Frontier {
+        public:
+            double priority;
+            uint64_t order;
+            GrowingNode *node;
+            DatasetView view;
+            int depth;
+            Attributes split;
+
+            bool operator<(const Frontier &other) const {
+                return priority < other.priority || (priority == other.priority && order > other.order);
+            }
+        };
+        priority_queue<Frontier> frontier;
+        uint64_t created = 0;
+
+        // Makes `node` a leaf of `view` and queues its best split, if any
+        auto addLeaf = [&](GrowingNode &node, const DatasetView &view, int depth) {
+            DT_PROFILE_ONLY(NodeProfile record(depth, view.size()); record.leaf = true;
+                            uint64_t started = profileNow();)
+            vector<uint32_t> counts = view.classCounts();
+            node.kind = NodeKind::Leaf;
+            node.label = majorityClass(counts, classNames);
+            node.classCounts = move(counts);
+            if (stopsBeforeSearch(view, node.classCounts, depth)) {
+                DT_PROFILE_ONLY(record.leafNanos = profileNow() - started; profile.add(record);)
+                return;
+            }
+            vector<SplitScores> scores = scoreAttributes(view);
+            int best = splitChoice(scores);
+            DT_PROFILE_ONLY(
+                record.rowsScanned = (uint64_t)view.size() * view.attributes.size();
+                for (size_t i = 0; i < scores.size(); ++i) {
+                    record.candidates.emplace_back(view.attributes[i], scores[i].candidates);
                 }
-            } else if (currentNode->attribute.type == "numerical") {
-                double value = stod(row.data[currentNode->attribute]);
-                string key = (value <= currentNode->attribute.threshold) ? "≤ " + to_string(currentNode->attribute.threshold) : "> " + to_string(currentNode->attribute.threshold);
-                if (currentNode->children.find(key) != currentNode->children.end()) {
-                    currentNode = currentNode->children[key];
+                record.splitSearchNanos = profileNow() - started;
+                profile.add(record);
+            )
+            if (best < 0) return;
+            double priority = view.size() * scores[best].score[InformationGain];
+            frontier.push({priority, created++, &node, view, depth, chosenAttribute(view, scores, best)});
+        };
+
+        addLeaf(root, rootView, 0);
+        size_t leaves = 1;
+        while (!frontier.empty()) {
+            Frontier next = frontier.top();
+            frontier.pop();
+            const Attributes &split = next.split;
+            size_t childCount = split.isNumerical() || next.view.binaryCategorical ? 2 : split.uniqueValues.size();
+            if (leaves + childCount - 1 > options.maxLeaves) continue;
+            leaves += childCount - 1;
+
+            DT_PROFILE_ONLY(NodeProfile record(next.depth, 0); uint64_t started = profileNow();)
+            GrowingNode &node = *next.node;
+            node.feature = split.index;
+            vector<DatasetView> subsets;
+            if (split.isNumerical()) {
+                node.kind = NodeKind::Numerical;
+                node.threshold = split.threshold;
+                pair<DatasetView, DatasetView> halves = partitionByNumerical(next.view, split, split.threshold);
+                subsets = {halves.first, halves.second};
+            } else if (next.view.binaryCategorical) {
+                node.kind = NodeKind::CategorySet;
+                node.categorySet = split.leftCodes;
+                pair<DatasetView, DatasetView> halves = partitionByCategorySet(next.view, split);
+                subsets = {halves.first, halves.second};
+            } else {
+                node.kind = NodeKind::Categorical;
+                subsets = partitionByCategorical(next.view, split);
+            }
+            node.childCount = subsets.size();
+            node.children = arena->allocate(subsets.size());
+            DT_PROFILE_ONLY(
+                // The node was profiled as a leaf when it was created
+                record.leaf = false;
+                record.partitionNanos = profileNow() - started;
+                for (const DatasetView &subset : subsets) record.emptyChildren += subset.size() == 0;
+                profile.splitLeaf(record);
+            )
+            for (size_t i = 0; i < subsets.size(); ++i) {
+                if (subsets[i].size() == 0) {
+                    // Empty children predict the parent's majority
+                    node.children[i].label = node.label;
                 } else {
-                    return ""; 
+                    addLeaf(node.children[i], subsets[i], next.depth + 1);
                 }
             }
         }
-        return currentNode->label;
     }
 
-    void printPrefix(Node* node, string prefix = "") {
-        if (node->isLeaf) {
-            cout << prefix << "Leaf: " << node->label << endl;
-        } else {
-            cout << prefix << "Node: " << node->attribute.name << endl;
-            for (const auto& child : node->children) {
-                printPrefix(child.second, prefix + "  ");
+    // Histograms of the children that will be split further: the smaller
+    // ones are counted from their rows, the largest is the parent's
+    // histogram minus theirs, so at most half of the rows are scanned.
+    // Returns the attribute values counted.
+    size_t deriveChildHistograms(const vector<uint32_t> &parentHistogram, const vector<DatasetView> &subsets,
+                                 vector<vector<uint32_t> *> &childHistograms) {
+        size_t largest = 0;
+        for (size_t i = 1; i < subsets.size(); ++i) {
+            if (subsets[i].size() > subsets[largest].size()) largest = i;
+        }
+        // All children lose the same attribute, so they split or not together
+        if (subsets[largest].attributes.empty()) return 0;
+
+        size_t scanned = 0;
+        vector<const vector<uint32_t> *> siblings;
+        for (size_t i = 0; i < subsets.size(); ++i) {
+            if (i == largest || subsets[i].size() == 0) continue;
+            childHistograms[i] = histograms->acquire();
+            fillHistogram(subsets[i], layout, *childHistograms[i]);
+            siblings.push_back(childHistograms[i]);
+            scanned += subsets[i].size() * subsets[i].attributes.size();
+        }
+        childHistograms[largest] = histograms->acquire();
+        subtractHistograms(subsets[largest], layout, parentHistogram, siblings, *childHistograms[largest]);
+        return scanned;
+    }
+
+    // Copies the finished tree into `nodes` in breadth-first order. The order
+    // depends only on the tree's shape, so serial and parallel builds give
+    // the same array.
+    void flatten(const GrowingNode &root) {
+        vector<const GrowingNode *> order = {&root};
+        size_t classCount = classNames.size();
+        nodes.clear();
+        classCounts.clear();
+        categorySets.clear();
+        levelStart = {0};
+        size_t levelEnd = 1;
+        for (size_t i = 0; i < order.size(); ++i) {
+            const GrowingNode &grown = *order[i];
+            Node node = Node();
+            if (grown.kind == NodeKind::CategorySet) {
+                node.categorySet = categorySets.size();
+                categorySets.push_back(attributes[grown.feature].uniqueValues.size());
+                categorySets.insert(categorySets.end(), grown.categorySet.begin(), grown.categorySet.end());
+            } else {
+                node.threshold = grown.threshold;
+            }
+            node.feature = grown.feature;
+            node.label = grown.label;
+            node.firstChild = order.size();
+            node.childCount = grown.childCount;
+            node.kind = grown.kind;
+            for (uint32_t c = 0; c < grown.childCount; ++c) {
+                order.push_back(&grown.children[c]);
+            }
+            nodes.push_back(node);
+            if (grown.classCounts.empty()) {
+                classCounts.insert(classCounts.end(), classCount, 0);
+            } else {
+                classCounts.insert(classCounts.end(), grown.classCounts.begin(), grown.classCounts.end());
+            }
+            if (i + 1 == levelEnd && order.size() > levelEnd) {
+                levelStart.push_back(levelEnd);
+                levelEnd = order.size();
+            }
+        }
+        levelStart.push_back(nodes.size());
+        nodes.shrink_to_fit();
+        classCounts.shrink_to_fit();
+        categorySets.shrink_to_fit();
+        DT_PROFILE_ONLY(profile.addBytes(nodes.capacity() * sizeof(Node) + classCounts.capacity() * sizeof(uint32_t) +
+                                         levelStart.capacity() * sizeof(uint32_t) +
+                                         categorySets.capacity() * sizeof(uint64_t));)
+    }
+
+    // Predicts the class id of row `row` of a dataset that shares this tree's
+    // attribute schema, descending at most depthCap levels
+    int predictClass(const Dataset &data, size_t row, int depthCap = INT_MAX) const {
+        return flat().predictClass(data, row, depthCap);
+    }
+
+    // Encodes raw values for predictClass(const FeatureRow&); values[i] is
+    // the text of attributes[i]. Encode once, score as often as needed.
+    FeatureRow encodeRow(const vector<string> &values) const {
+        return encodeFeatures(attributes, dictionaries, values);
+    }
+
+    // Online scoring: one compare or one array index per level
+    int predictClass(const FeatureRow &row) const {
+        return flat().predictClass(row);
+    }
+
+    // Class ids of all rows of `data`, scored on `threads` threads
+    void predictBatch(const Dataset &data, vector<int> &classes, int threads = 1, int depthCap = INT_MAX) const {
+        flat().predictBatch(data, classes, threads, depthCap);
+    }
+
+    // On a pool the caller keeps across calls (see FlatTree::predictBatch)
+    void predictBatch(const Dataset &data, vector<int> &classes, ThreadPool &pool, int depthCap = INT_MAX) const {
+        flat().predictBatch(data, classes, pool, depthCap);
+    }
+
+    // Class probabilities of all rows of `data` (see FlatTree::predictBatch)
+    void predictBatch(const Dataset &data, vector<float> &probabilities, int threads = 1,
+                      int depthCap = INT_MAX) const {
+        flat().predictBatch(data, probabilities, threads, depthCap);
+    }
+
+    void predictBatch(const Dataset &data, vector<float> &probabilities, ThreadPool &pool,
+                      int depthCap = INT_MAX) const {
+        flat().predictBatch(data, probabilities, pool, depthCap);
+    }
+
+    // See FlatTree::routeRows and FlatTree::nextNode
+    void routeRows(const Dataset &data, size_t begin, size_t end, int depthCap, uint32_t *reached) const {
+        flat().routeRows(data, begin, end, depthCap, reached);
+    }
+
+    uint32_t nextNode(uint32_t index, const Dataset &data, size_t row) const {
+        return flat().nextNode(index, data, row);
+    }
+
+    // View of this tree's arrays; valid until the tree changes
+    FlatTree flat() const {
+        return {nodes.data(), nodes.size(), categorySets.data(), classCounts.data(), classNames.size(), defaultClass};
+    }
+
+    string predictLabel(const Dataset &data, size_t row) const {
+        int label = predictClass(data, row);
+        return label >= 0 ? classNames[label] : "";
+    }
+
+    // Branch names sort the same way as before the tree was flattened
+    void printPrefix(size_t index = 0, string prefix = "") {
+        const Node &node = nodes[index];
+        if (node.isLeaf()) {
+            cout << prefix << "Leaf: " << (node.label >= 0 ? classNames[node.label] : "") << endl;
+            return;
+        }
+        const Attributes &attribute = attributes[node.feature];
+        cout << prefix << "Node: " << attribute.name << " (Type: " << attribute.type << ", Index: " << attribute.index << ")" << endl;
+        vector<pair<string, size_t>> branches;
+        for (uint32_t c = 0; c < node.childCount; ++c) {
+            string branch;
+            if (node.kind == NodeKind::Numerical) {
+                branch = (c == 0 ? "≤ " : "> ") + to_string(node.threshold);
+            } else if (node.kind == NodeKind::CategorySet) {
+                string categories;
+                for (uint32_t code = 0; code < attribute.uniqueValues.size(); ++code) {
+                    if (flat().setChild(node, code) != 0) continue;
+                    categories += (categories.empty() ? "" : ", ") + attribute.uniqueValues[code];
+                }
+                branch = (c == 0 ? "in {" : "not in {") + categories + "}";
+            } else {
+                branch = attribute.uniqueValues[c];
             }
+            branches.emplace_back(branch, node.firstChild + c);
+        }
+        sort(branches.begin(), branches.end());
+        for (const auto& branch : branches) {
+            cout << prefix << "  Branch: " << branch.first << endl;
+            printPrefix(branch.second, prefix + "    ");
+        }
+    }
+
+private:
+    // Dataset quantized for histogram mode, or nullptr if `dataset` already
+    // is (or the options do not use histograms). Quantize once, up front,
+    // to avoid a copy per tree.
+    static unique_ptr<Dataset> quantizedCopy(const Dataset &dataset, const TreeOptions &options) {
+        if (!options.histogramSplits || dataset.maxBins == clampedBins(options.maxBins)) return nullptr;
+        unique_ptr<Dataset> copy(new Dataset(dataset));
+        copy->quantize(options.maxBins);
+        return copy;
+    }
+
+    // Grows the tree from all rows of `dataset`, quantized if histogram
+    // mode is on
+    void build(const Dataset &dataset) {
+        // The only per-build copy is this row-index array; every node works
+        // on a slice of it and the dataset columns are shared read-only.
+        vector<size_t> rowIndices(dataset.size());
+        iota(rowIndices.begin(), rowIndices.end(), 0);
+        DatasetView view(dataset, rowIndices);
+        view.binaryCategorical = options.binaryCategoricalSplits;
+        view.minLeafRows = max<size_t>(1, options.minSamplesLeaf);
+        view.useHistograms = options.histogramSplits;
+
+        unique_ptr<HistogramPool> histogramPool;
+        if (options.histogramSplits && options.maxLeaves == 0) {
+            layout = HistogramLayout(dataset);
+            histogramPool.reset(new HistogramPool(layout.size, options.histogramPoolSize));
+            histograms = histogramPool.get();
+        }
+
+        NodeArena nodeArena;
+        arena = &nodeArena;
+        GrowingNode root;
+        if (options.maxLeaves > 0) {
+            buildBestFirst(root, view);
+        } else if (options.threads > 1) {
+            // The calling thread helps while it waits, so it is one of the threads
+            ThreadPool threadPool(options.threads - 1);
+            TaskGroup tasks(threadPool);
+            pool = &threadPool;
+            buildTree(root, view, 0, &tasks);
+            tasks.wait();
+            pool = nullptr;
+        } else {
+            buildTree(root, view, 0);
         }
+        histograms = nullptr;
+        arena = nullptr;
+        flatten(root);
+        DT_PROFILE_ONLY(
+            profile.addBytes(rowIndices.capacity() * sizeof(size_t) + nodeArena.allocatedBytes +
+                             (histogramPool ? histogramPool->allocatedBytes.load() : 0));
+        )
+    }
+
+    // Everything but the nodes, which the caller grows
+    DecisionTree(const Dataset &dataset, enum SelectionCriteria criterion, const TreeOptions &options, bool)
+        : attributes(dataset.attributes), dictionaries(dataset.dictionaries), criterion(criterion),
+          classNames(dataset.classNames), defaultClass(dataset.getMajorityClass()), maxDepth(options.maxDepth),
+          options(options), pool(nullptr), arena(nullptr), histograms(nullptr) {
+        DT_PROFILE_ONLY(
+            vector<string> names;
+            for (const Attributes &attribute : attributes) names.push_back(attribute.name);
+            profile.reset(names);
+        )
     }
 
+    // State of a growTogether build
+    class SharedGrowth {
+    public:
+        vector<DecisionTree> *trees;
+        // Rows of the groups that split away from the others, kept until the
+        // build ends
+        mutex lock;
+        deque<vector<size_t>> rowCopies;
+    };
+
+    // growTogether at one node: trees[members[i]] grows *nodes[i] from the
+    // rows of `view`. All trees share maxDepth and options. Profiled work
+    // that trees share is counted in the profile of each of them.
+    static void growShared(SharedGrowth &growth, const vector<int> &members, const vector<GrowingNode *> &nodes,
+                           const DatasetView &view, int depth, TaskGroup *tasks) {
+        vector<DecisionTree> &trees = *growth.trees;
+        const DecisionTree &lead = trees[members[0]];
+        DT_PROFILE_ONLY(NodeProfile record(depth, view.size()); uint64_t started = profileNow();)
+        vector<uint32_t> counts = view.classCounts();
+        int label = majorityClass(counts, lead.classNames);
+
+        // One statistics pass scores every attribute under every criterion
+        vector<SplitScores> scores;
+        vector<int> choice(members.size(), -1);
+        if (!lead.stopsBeforeSearch(view, counts, depth)) {
+            bool splitSearchInParallel = lead.pool && lead.options.parallelAttributes &&
+                                         view.size() >= lead.options.parallelCutoff;
+            scores = scoreAttributes(view, splitSearchInParallel ? lead.pool : nullptr);
+            for (size_t i = 0; i < members.size(); ++i) {
+                choice[i] = trees[members[i]].splitChoice(scores);
+            }
+            DT_PROFILE_ONLY(
+                record.rowsScanned = (uint64_t)view.size() * view.attributes.size();
+                for (size_t i = 0; i < scores.size(); ++i) {
+                    record.candidates.emplace_back(view.attributes[i], scores[i].candidates);
+                }
+            )
+        }
+        DT_PROFILE_ONLY(record.splitSearchNanos = profileNow() - started;)
+
+        // Trees that chose the same attribute stay together; -1 is a leaf
+        map<int, vector<size_t>> groups;
+        for (size_t i = 0; i < members.size(); ++i) {
+            groups[choice[i]].push_back(i);
+        }
+
+        // The first splitting group partitions the node's rows in place; the
+        // others copy them first, before any child task starts reordering
+        vector<DatasetView> groupViews;
+        for (const auto &group : groups) {
+            if (group.first < 0) continue;
+            groupViews.push_back(view);
+            if (groupViews.size() == 1) continue;
+            lock_guard<mutex> guard(growth.lock);
+            growth.rowCopies.emplace_back(view.rowIndices->begin() + view.begin, view.rowIndices->begin() + view.end);
+            DT_PROFILE_ONLY(
+                for (size_t i : group.second) {
+                    trees[members[i]].profile.addBytes(view.size() * sizeof(size_t));
+                }
+            )
+            groupViews.back().rowIndices = &growth.rowCopies.back();
+            groupViews.back().begin = 0;
+            groupViews.back().end = view.size();
+        }
+
+        size_t nextView = 0;
+        for (const auto &group : groups) {
+            if (group.first < 0) {
+                DT_PROFILE_ONLY(uint64_t leafStarted = profileNow();)
+                for (size_t i : group.second) {
+                    nodes[i]->kind = NodeKind::Leaf;
+                    nodes[i]->label = label;
+                    nodes[i]->classCounts = counts;
+                }
+                DT_PROFILE_ONLY(
+                    NodeProfile leafRecord = record;
+                    leafRecord.leaf = true;
+                    leafRecord.leafNanos = profileNow() - leafStarted;
+                    for (size_t i : group.second) trees[members[i]].profile.add(leafRecord);
+                )
+                continue;
+            }
+            DT_PROFILE_ONLY(uint64_t partitionStarted = profileNow();)
+            const DatasetView &groupView = groupViews[nextView++];
+            Attributes attribute = chosenAttribute(view, scores, group.first);
+            vector<DatasetView> subsets;
+            if (attribute.isNumerical()) {
+                pair<DatasetView, DatasetView> halves = partitionByNumerical(groupView, attribute, attribute.threshold);
+                subsets = {halves.first, halves.second};
+            } else if (view.binaryCategorical) {
+                pair<DatasetView, DatasetView> halves = partitionByCategorySet(groupView, attribute);
+                subsets = {halves.first, halves.second};
+            } else {
+                subsets = partitionByCategorical(groupView, attribute);
+            }
+
+            vector<int> groupMembers;
+            vector<vector<GrowingNode *>> children(subsets.size());
+            for (size_t i : group.second) {
+                GrowingNode &node = *nodes[i];
+                node.feature = attribute.index;
+                if (attribute.isNumerical()) {
+                    node.kind = NodeKind::Numerical;
+                    node.threshold = attribute.threshold;
+                } else if (view.binaryCategorical) {
+                    node.kind = NodeKind::CategorySet;
+                    node.categorySet = attribute.leftCodes;
+                } else {
+                    node.kind = NodeKind::Categorical;
+                }
+                node.childCount = subsets.size();
+                node.children = trees[members[i]].arena->allocate(subsets.size());
+                node.label = label;
+                node.classCounts = counts;
+                groupMembers.push_back(members[i]);
+                for (size_t c = 0; c < subsets.size(); ++c) {
+                    children[c].push_back(&node.children[c]);
+                }
+            }
+            DT_PROFILE_ONLY(
+                NodeProfile splitRecord = record;
+                splitRecord.partitionNanos = profileNow() - partitionStarted;
+                for (const DatasetView &subset : subsets) splitRecord.emptyChildren += subset.size() == 0;
+                for (size_t i : group.second) trees[members[i]].profile.add(splitRecord);
+            )
+
+            for (size_t c = 0; c < subsets.size(); ++c) {
+                if (subsets[c].size() == 0) {
+                    // Empty children predict the parent's majority
+                    for (GrowingNode *child : children[c]) child->label = label;
+                    continue;
+                }
+                DatasetView subset = subsets[c];
+                vector<GrowingNode *> childNodes = children[c];
+                auto grow = [&growth, groupMembers, childNodes, subset, depth, tasks] {
+                    if (groupMembers.size() == 1) {
+                        (*growth.trees)[groupMembers[0]].buildTree(*childNodes[0], subset, depth + 1, tasks);
+                    } else {
+                        growShared(growth, groupMembers, childNodes, subset, depth + 1, tasks);
+                    }
+                };
+                if (tasks && subset.size() >= lead.options.parallelCutoff) {
+                    tasks->run(grow);
+                } else {
+                    grow();
+                }
+            }
+        }
+    }
 
+    // Pool of the build in progress, if it is parallel
+    ThreadPool *pool;
+    // Nodes of the build in progress
+    NodeArena *arena;
+    // Histogram mode state of the build in progress
+    HistogramPool *histograms;
+    HistogramLayout layout;
 };
 
 #endif // DT_LIBRARY_HPP
\ No newline at end of file
@@ -0,0 +1,269 @@
+#ifndef CODEGEN_LIBRARY_HPP
+#define CODEGEN_LIBRARY_HPP
+
+#include <bits/stdc++.h>
+using namespace std;
+
+#include "attributeLibrary.hpp"
+#include "DTLibrary.hpp"
+
+// Export of a trained tree as a self-contained C++ header (C++11, standard
+// headers only). The header holds, in namespace `name`:
+//   Features      one field per attribute: double for numerical attributes
+//                 (NaN when missing), int32_t dictionary code for categorical
+//                 ones (-1 when unknown; <attribute>Values lists the codes)
+//   predict       class id of a Features, exactly as DecisionTree::
+//                 predictClass scores the same row
+//   classNames    class name of each class id
+// Small trees become one branch per node, with thresholds and category sets
+// as literals, so the compiler can inline the whole tree. Larger ones become
+// a constant node table and a loop.
+class CodegenOptions {
+public:
+    // Namespace and include guard of the generated code
+    string name;
+    // Nodes at this level act as leaves (see DecisionTree::getDepth)
+    int depthCap;
+    // Trees with more nodes than this use the node table
+    size_t maxBranchNodes;
+
+    CodegenOptions() : name("model"), depthCap(INT_MAX), maxBranchNodes(4096) {}
+};
+
+// A valid, unique C++ identifier for `text`
+string cppIdentifier(const string &text, set<string> &used) {
+    static const set<string> keywords = {
+        "alignas", "alignof", "and", "and_eq", "asm", "auto", "bitand", "bitor", "bool", "break", "case", "catch",
+        "char", "char16_t", "char32_t", "class", "compl", "const", "const_cast", "constexpr", "continue", "decltype",
+        "default", "delete", "do", "double", "dynamic_cast", "else", "enum", "explicit", "export", "extern", "false",
+        "float", "for", "friend", "goto", "if", "inline", "int", "long", "mutable", "namespace", "new", "noexcept",
+        "not", "not_eq", "nullptr", "operator", "or", "or_eq", "private", "protected", "public", "register",
+        "reinterpret_cast", "return", "short", "signed", "sizeof", "static", "static_assert", "static_cast",
+        "struct", "switch", "template", "this", "thread_local", "throw", "true", "try", "typedef", "typeid",
+        "typename", "union", "unsigned", "using", "virtual", "void", "volatile", "wchar_t", "while", "xor", "xor_eq"};
+    string identifier;
+    for (char c : text) {
+        identifier += isalnum((unsigned char)c) ? c : '_';
+    }
+    if (identifier.empty() || isdigit((unsigned char)identifier[0])) identifier = "_" + identifier;
+    // Names with double underscores or _ + capital are reserved
+    while (identifier.find("__") != string::npos) identifier.replace(identifier.find("__"), 2, "_");
+    if (identifier[0] == '_' && (identifier.size() == 1 || !islower((unsigned char)identifier[1]))) {
+        identifier = "f" + identifier;
+    }
+    if (keywords.count(identifier)) identifier += "_";
+    string unique = identifier;
+    for (int suffix = 2; used.count(unique) || used.count(unique + "Values"); ++suffix) {
+        unique = identifier + "_" + to_string(suffix);
+    }
+    used.insert(unique);
+    used.insert(unique + "Values");
+    return unique;
+}
+
+string cppString(const string &text) {
+    string quoted = "\"";
+    for (unsigned char c : text) {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+            quoted += c;
+        } else if (c < 32 || c == 127) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\%03o", c);
+            quoted += escaped;
+        } else {
+            quoted += c;
+        }
+    }
+    return quoted + "\"";
+}
+
+// Double literal that reads back as exactly `value`
+string cppDouble(double value) {
+    if (isinf(value)) return value > 0 ? "HUGE_VAL" : "-HUGE_VAL";
+    char text[32];
+    snprintf(text, sizeof(text), "%.17g", value);
+    string literal = text;
+    if (literal.find_first_of(".e") == string::npos) literal += ".0";
+    return literal;
+}
+
+// Writes the header for `tree`, a DecisionTree or a TreeModel (modelLibrary.hpp).
+// Returns false if the file cannot be written.
+template <class Tree>
+bool exportCpp(const Tree &tree, const string &filename, const CodegenOptions &options = CodegenOptions()) {
+    size_t nodeCount = tree.getSize(options.depthCap);
+    int depth = tree.getDepth(options.depthCap);
+    // Nodes of the last level kept are leaves of the exported tree
+    size_t lastLevel = depth > 0 ? tree.levelStart[depth - 1] : 0;
+    auto isLeaf = [&](size_t i) { return tree.nodes[i].isLeaf() || i >= lastLevel; };
+
+    set<string> used;
+    string name = cppIdentifier(options.name, used);
+    string guard = name;
+    for (char &c : guard) c = toupper((unsigned char)c);
+    guard += "_GENERATED_HPP";
+    vector<string> fields;
+    for (const Attributes &attribute : tree.attributes) {
+        fields.push_back(cppIdentifier(attribute.name, used));
+    }
+
+    ostringstream out;
+    const char *criterionNames[] = {"IG", "IGR", "NWIG"};
+    out << "// Generated from a decision tree (" << criterionNames[tree.criterion] << ", " << nodeCount << " nodes, depth "
+        << depth << "). Do not edit.\n";
+    out << "#ifndef " << guard << "\n#define " << guard << "\n\n";
+    out << "#include <cmath>\n#include <cstdint>\n\nnamespace " << name << " {\n\n";
+
+    out << "const int classCount = " << tree.classNames.size() << ";\n";
+    out << "const char *const classNames[" << max<size_t>(1, tree.classNames.size()) << "] = {";
+    for (size_t c = 0; c < tree.classNames.size(); ++c) {
+        out << (c ? ", " : "") << cppString(tree.classNames[c]);
+    }
+    out << "};\n\n";
+    for (size_t a = 0; a < tree.attributes.size(); ++a) {
+        const Attributes &attribute = tree.attributes[a];
+        if (attribute.isNumerical()) continue;
+        out << "// Dictionary codes of " << fields[a] << "\n";
+        out << "const char *const " << fields[a] << "Values[" << max<size_t>(1, attribute.uniqueValues.size()) << "] = {";
+        for (size_t code = 0; code < attribute.uniqueValues.size(); ++code) {
+            out << (code ? "," : "") << (code % 8 == 0 ? "\n    " : " ") << cppString(attribute.uniqueValues[code]);
+        }
+        out << "};\n";
+    }
+    out << "\nstruct Features {\n";
+    for (size_t a = 0; a < tree.attributes.size(); ++a) {
+        out << "    " << (tree.attributes[a].isNumerical() ? "double " : "int32_t ") << fields[a] << ";\n";
+    }
+    out << "};\n\n";
+
+    int defaultClass = tree.defaultClass;
+    if (nodeCount <= options.maxBranchNodes) {
+        // One branch per node, children nested in their parents. A subtree
+        // whose leaves all predict the default class predicts it for every
+        // row, unroutable ones included, and becomes a single return.
+        const int mixed = INT_MIN;
+        vector<int> constant(nodeCount);
+        for (size_t i = nodeCount; i-- > 0;) {
+            const Node &node = tree.nodes[i];
+            if (isLeaf(i)) {
+                constant[i] = node.label;
+                continue;
+            }
+            constant[i] = defaultClass;
+            for (uint32_t c = 0; c < node.childCount; ++c) {
+                if (constant[node.firstChild + c] != defaultClass) constant[i] = mixed;
+            }
+        }
+        out << "inline int predict(const Features &x) {\n";
+        function<void(size_t, int)> emit = [&](size_t i, int indent) {
+            string pad(indent * 4, ' ');
+            if (nodeCount == 0) {
+                out << pad << "return " << defaultClass << ";\n";
+                return;
+            }
+            const Node &node = tree.nodes[i];
+            if (constant[i] != mixed) {
+                out << pad << "return " << constant[i] << ";\n";
+                return;
+            }
+            string field = "x." + fields[node.feature];
+            if (node.kind == NodeKind::Numerical) {
+                // NaN fails the compare and goes right, as in training
+                out << pad << "if (" << field << " <= " << cppDouble(node.threshold) << ") {\n";
+                emit(node.firstChild, indent + 1);
+                out << pad << "} else {\n";
+                emit(node.firstChild + 1, indent + 1);
+                out << pad << "}\n";
+            } else if (node.kind == NodeKind::Categorical) {
+                out << pad << "switch (" << field << ") {\n";
+                for (uint32_t c = 0; c < node.childCount; ++c) {
+                    out << pad << "case " << c << ": {\n";
+                    emit(node.firstChild + c, indent + 1);
+                    out << pad << "}\n";
+                }
+                out << pad << "default:\n" << pad << "    return " << defaultClass << ";\n" << pad << "}\n";
+            } else {
+                // Category set: codes in the set go to the first child
+                const uint64_t *set = &tree.categorySets[node.categorySet];
+                out << pad << "if ((uint32_t)" << field << " >= " << set[0] << "u) return " << defaultClass << ";\n";
+                if (set[0] <= 64) {
+                    out << pad << "if ((UINT64_C(0x" << hex << (set[0] ? set[1] : 0) << dec << ") >> " << field
+                        << ") & 1) {\n";
+                } else {
+                    out << pad << "static const uint64_t set[] = {";
+                    for (uint64_t w = 0; w < (set[0] + 63) / 64; ++w) {
+                        out << (w ? ", " : "") << "UINT64_C(0x" << hex << set[1 + w] << dec << ")";
+                    }
+                    out << "};\n" << pad << "if ((set[" << field << " / 64] >> (" << field << " % 64)) & 1) {\n";
+                }
+                emit(node.firstChild, indent + 1);
+                out << pad << "} else {\n";
+                emit(node.firstChild + 1, indent + 1);
+                out << pad << "}\n";
+            }
+        };
+        emit(0, 1);
+        out << "}\n\n";
+    } else {
+        // Node table in DecisionTree order: kind 0 leaf, 1 numerical,
+        // 2 categorical, 3 category set (`set` indexes categorySets)
+        out << "struct Node {\n    double threshold;\n    uint32_t set;\n    int32_t feature;\n    int32_t label;\n"
+            << "    uint32_t firstChild;\n    uint32_t childCount;\n    uint8_t kind;\n};\n\n";
+        out << "const Node nodes[" << max<size_t>(1, nodeCount) << "] = {";
+        vector<uint64_t> sets;
+        for (size_t i = 0; i < nodeCount; ++i) {
+            const Node &node = tree.nodes[i];
+            bool leaf = isLeaf(i);
+            uint32_t setOffset = 0;
+            if (!leaf && node.kind == NodeKind::CategorySet) {
+                const uint64_t *set = &tree.categorySets[node.categorySet];
+                setOffset = sets.size();
+                sets.insert(sets.end(), set, set + 1 + (set[0] + 63) / 64);
+            }
+            out << (i ? "," : "") << "\n    {"
+                << (!leaf && node.kind == NodeKind::Numerical ? cppDouble(node.threshold) : "0") << ", " << setOffset
+                << ", " << (leaf ? -1 : node.feature) << ", " << node.label << ", " << (leaf ? 0 : node.firstChild)
+                << ", " << (leaf ? 0 : node.childCount) << ", " << (leaf ? 0 : (int)node.kind) << "}";
+        }
+        out << "};\n\n";
+        out << "const uint64_t categorySets[" << max<size_t>(1, sets.size()) << "] = {";
+        for (size_t w = 0; w < sets.size(); ++w) {
+            out << (w ? "," : "") << (w % 4 == 0 ? "\n    " : " ") << "UINT64_C(0x" << hex << sets[w] << dec << ")";
+        }
+        out << "};\n\n";
+        out << "inline int predict(const Features &x) {\n";
+        out << "    union Value {\n        double number;\n        int32_t code;\n    } values["
+            << max<size_t>(1, tree.attributes.size()) << "];\n";
+        for (size_t a = 0; a < tree.attributes.size(); ++a) {
+            out << "    values[" << a << "]." << (tree.attributes[a].isNumerical() ? "number" : "code") << " = x."
+                << fields[a] << ";\n";
+        }
+        out << "    const Node *node = nodes;\n"
+            << "    while (node->kind != 0) {\n"
+            << "        Value value = values[node->feature];\n"
+            << "        uint32_t child;\n"
+            << "        if (node->kind == 1) {\n"
+            << "            child = !(value.number <= node->threshold);\n"
+            << "        } else if (node->kind == 2) {\n"
+            << "            child = (uint32_t)value.code;\n"
+            << "        } else {\n"
+            << "            const uint64_t *set = categorySets + node->set;\n"
+            << "            uint32_t code = (uint32_t)value.code;\n"
+            << "            child = code >= set[0] ? 2 : ((set[1 + code / 64] >> (code % 64)) & 1) ? 0 : 1;\n"
+            << "        }\n"
+            << "        if (child >= node->childCount) return " << defaultClass << ";\n"
+            << "        node = nodes + node->firstChild + child;\n"
+            << "    }\n"
+            << "    return node->label;\n"
+            << "}\n\n";
+    }
+    out << "} // namespace " << name << "\n\n#endif // " << guard << "\n";
+
+    ofstream file(filename, ios::trunc);
+    string text = out.str();
+    file.write(text.data(), text.size());
+    return bool(file);
+}
+
+#endif // CODEGEN_LIBRARY_HPP
@@ -0,0 +1,138 @@
+#ifndef HISTOGRAM_LIBRARY_HPP
+#define HISTOGRAM_LIBRARY_HPP
+
+#include <bits/stdc++.h>
+using namespace std;
+
+#include "datasetLibrary.hpp"
+#include "profileLibrary.hpp"
+
+// Where each attribute's class counts live inside one flat node histogram.
+// A numerical attribute has one slot per bin plus a last slot for missing
+// values, a categorical attribute one slot per dictionary code; every slot
+// holds classCount counters.
+class HistogramLayout {
+public:
+    int classCount;
+    vector<size_t> offset;
+    vector<int> slots;
+    size_t size;
+
+    HistogramLayout() : classCount(0), size(0) {}
+
+    explicit HistogramLayout(const Dataset &data)
+        : classCount(data.classCount()), size(0) {
+        offset.assign(data.attributes.size(), 0);
+        slots.assign(data.attributes.size(), 0);
+        for (const auto &attr : data.attributes) {
+            if (attr.isNumerical()) {
+                slots[attr.index] = data.binThresholds[attr.index].size() + 2;
+            } else {
+                slots[attr.index] = attr.uniqueValues.size();
+            }
+            offset[attr.index] = size;
+            size += slots[attr.index] * classCount;
+        }
+    }
+
+    uint32_t *counts(vector<uint32_t> &histogram, int column) const {
+        return histogram.data() + offset[column];
+    }
+
+    const uint32_t *counts(const vector<uint32_t> &histogram, int column) const {
+        return histogram.data() + offset[column];
+    }
+};
+
+// Reusable histogram buffers for one build. Buffers are handed back as soon
+// as a node has derived its children's histograms; at most `capacity` idle
+// buffers are kept, the rest are freed. Safe to share between threads.
+class HistogramPool {
+public:
+    HistogramPool(size_t bufferSize, size_t capacity)
+        : bufferSize(bufferSize), capacity(capacity) {}
+
+    ~HistogramPool() {
+        for (auto buffer : idle) {
+            delete buffer;
+        }
+    }
+
+    vector<uint32_t> *acquire() {
+        {
+            lock_guard<mutex> guard(lock);
+            if (!idle.empty()) {
+                vector<uint32_t> *buffer = idle.back();
+                idle.pop_back();
+                return buffer;
+            }
+        }
+        DT_PROFILE_ONLY(allocatedBytes += bufferSize * sizeof(uint32_t);)
+        return new vector<uint32_t>(bufferSize);
+    }
+
+    void release(vector<uint32_t> *buffer) {
+        if (!buffer) return;
+        lock_guard<mutex> guard(lock);
+        if (idle.size() < capacity) {
+            idle.push_back(buffer);
+        } else {
+            delete buffer;
+        }
+    }
+
+private:
+    size_t bufferSize;
+    size_t capacity;
+    mutex lock;
+    vector<vector<uint32_t> *> idle;
+
+public:
+    // Bytes of all buffers ever created
+    DT_PROFILE_ONLY(atomic<uint64_t> allocatedBytes{0};)
+};
+
+// Counts the view's rows into `histogram` for every attribute still usable
+// at the view
+void fillHistogram(const DatasetView &view, const HistogramLayout &layout, vector<uint32_t> &histogram) {
+    int classCount = layout.classCount;
+    const vector<int> &labels = view.data->labels;
+    for (int column : view.attributes) {
+        uint32_t *counts = layout.counts(histogram, column);
+        fill(counts, counts + layout.slots[column] * classCount, 0);
+        if (view.data->attributes[column].isNumerical()) {
+            const vector<uint8_t> &bins = view.data->binnedColumns[column];
+            int missingSlot = layout.slots[column] - 1;
+            for (size_t i = 0; i < view.size(); ++i) {
+                size_t row = view.row(i);
+                int slot = bins[row] == MISSING_BIN ? missingSlot : bins[row];
+                counts[slot * classCount + labels[row]]++;
+            }
+        } else {
+            const vector<int> &codes = view.data->categoricalColumns[column];
+            for (size_t i = 0; i < view.size(); ++i) {
+                size_t row = view.row(i);
+                counts[codes[row] * classCount + labels[row]]++;
+            }
+        }
+    }
+}
+
+// result = parent - sum(siblings), over the attributes usable at `view`
+void subtractHistograms(const DatasetView &view, const HistogramLayout &layout, const vector<uint32_t> &parent,
+                        const vector<const vector<uint32_t> *> &siblings, vector<uint32_t> &result) {
+    for (int column : view.attributes) {
+        size_t begin = layout.offset[column];
+        size_t end = begin + layout.slots[column] * layout.classCount;
+        for (size_t i = begin; i < end; ++i) {
+            result[i] = parent[i];
+        }
+        for (const vector<uint32_t> *sibling : siblings) {
+            for (size_t i = begin; i < end; ++i) {
+                result[i] -= (*sibling)[i];
+            }
+        }
+    }
+}
+
+#endif // HISTOGRAM_LIBRARY_HPP
@@ -2,83 +2,74 @@
 #include "datasetLibrary.hpp"
 #include "selectionCriteriaLibrary.hpp"
 #include "DTLibrary.hpp"
+#include "experimentLibrary.hpp"
 
 #include <bits/stdc++.h>
 using namespace std;
 
 
-void loadIrisCSV(const string& filename, Dataset& dataset) {
-    ifstream file(filename);
-    string line;
-    getline(file, line); 
-
-    while (getline(file, line)) {
-        stringstream ss(line);
-        vector<string> cells;
-        string cell;
-
-        while (getline(ss, cell, ',')) {
-            cells.push_back(cell);
-        }
-
-        map<Attributes, string> data;
-
-        for (size_t i = 0; i < dataset.attributes.size(); ++i) {
-            data[dataset.attributes[i]] = cells[i + 1]; 
-        }
-        string label = cells.back(); 
-
-        dataset.rows.emplace_back(data, label);
-        dataset.labels.push_back(label);
+void run(Dataset& dataset) {
+    // maxDepth 1-6 x IG/IGR/NWIG, 20 seeded splits each (see ExperimentGrid)
+    ExperimentGrid grid;
+    grid.output = "iris_results.csv";
+    // iris_grid.cfg, when present, overrides the grid
+    ExperimentGrid configured = grid;
+    if (loadExperimentGrid("iris_grid.cfg", configured)) {
+        grid = configured;
+    } else if (ifstream("iris_grid.cfg")) {
+        cerr << "iris_grid.cfg does not parse; running the default grid" << endl;
     }
+    writeExperimentCSV(runExperiment(dataset, grid), grid.output);
 }
 
-void run(Dataset& dataset) {
+// Trains the run() grid twice on identical splits, once with exact
+// thresholds and once with histogram splits over `bins` bins, and reports
+// how far the test accuracy drifts. The bins come from the training rows
+// only. Repetition i splits with the grid's seedFor(i), as run() does.
+void runBinningDrift(const Dataset& dataset, int bins) {
+    ExperimentGrid grid;
     vector<int> maxDepths = {1, 2, 3, 4, 5,6};
     vector<SelectionCriteria> criteria = {InformationGain, InformationGainRatio, NormalizedWeightedInformationGain};
-    ofstream outputFile("iris_results.csv");
-    outputFile << "Max Depth,Selection Criteria,trainTime(ms),treeSize,Accuracy(%)\n";
+    ofstream outputFile("iris_binning_drift.csv");
+    outputFile << "Max Depth,Selection Criteria,Bins,exactAccuracy(%),binnedAccuracy(%),drift(%)\n";
 
     for (int maxDepth : maxDepths) {
         for (SelectionCriteria criterion : criteria) {
-            double avgTrainTime = 0.0, avgAccuracy = 0.0, avgTreeSize = 0.0;
-            for (int i = 1; i <= 20; i++) {
-                pair<Dataset, Dataset> split = trainTestSplitRandom(dataset, 0.8);
-                auto start = chrono::high_resolution_clock::now();
-                DecisionTree dt(split.first, criterion, maxDepth);
-                auto end = chrono::high_resolution_clock::now();
-                chrono::duration<double, milli> trainTime = end - start;
-                avgTrainTime += trainTime.count();
-                avgTreeSize += dt.getSize();
-
-                int correctPredictions = 0;
-                for (auto& row : split.second.rows) {
-                    string predictedLabel = dt.predictLabel(row);
-                    if (predictedLabel == row.label) {
-                        correctPredictions++;
-                    }
+            double exactAccuracy = 0.0, binnedAccuracy = 0.0;
+            for (int i = 0; i < grid.repetitions; i++) {
+                pair<Dataset, Dataset> split = trainTestSplitRandom(dataset, grid.trainSize, grid.seedFor(i));
+                split.first.quantize(bins);
+                TreeOptions binned(maxDepth);
+                binned.histogramSplits = true;
+                binned.maxBins = bins;
+                DecisionTree exactTree(split.first, criterion, maxDepth);
+                DecisionTree binnedTree(split.first, criterion, binned);
+
+                int exactCorrect = 0, binnedCorrect = 0;
+                for (size_t row = 0; row < split.second.size(); ++row) {
+                    exactCorrect += exactTree.predictClass(split.second, row) == split.second.labels[row];
+                    binnedCorrect += binnedTree.predictClass(split.second, row) == split.second.labels[row];
                 }
-
-                avgAccuracy += static_cast<double>(correctPredictions) / split.second.rows.size() * 100;
+                exactAccuracy += static_cast<double>(exactCorrect) / split.second.size() * 100;
+                binnedAccuracy += static_cast<double>(binnedCorrect) / split.second.size() * 100;
             }
 
-            outputFile << maxDepth << "," << criterion << "," << avgTrainTime / 20 << "," << (int)(avgTreeSize / 20) << "," << avgAccuracy / 20 << "\n";
+            outputFile << maxDepth << "," << criterion << "," << bins << "," << exactAccuracy / grid.repetitions << ","
+                       << binnedAccuracy / grid.repetitions << "," << (binnedAccuracy - exactAccuracy) / grid.repetitions
+                       << "\n";
         }
     }
 }
 
-int main()
+int main(int argc, char* argv[])
 {
     Dataset dataset;
     dataset.name = "Iris Dataset";
-    vector<Attributes> attributes = {  
-        Attributes("sepal_length", "numerical", {}),
-        Attributes("sepal_width", "numerical", {}),
-        Attributes("petal_length", "numerical", {}),
-        Attributes("petal_width", "numerical", {})
-    };
-    dataset.attributes = attributes;
-    loadIrisCSV("iris.csv", dataset);
+    // Column names come from the header; Id is just the row number
+    CSVOptions csv;
+    csv.hasHeader = true;
+    csv.exclude = {"Id"};
+    loadCSV("iris.csv", dataset, csv);
     //printDataset(dataset);
 
 
@@ -92,5 +83,10 @@ int main()
 
     run(dataset);
 
+    // Optional: iris <bins> also reports the accuracy drift of histogram splits
+    if (argc > 1) {
+        runBinningDrift(dataset, stoi(argv[1]));
+    }
+
     return 0;
 }
\ No newline at end of file
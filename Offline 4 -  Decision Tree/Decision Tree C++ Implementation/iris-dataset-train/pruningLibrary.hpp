@@ -0,0 +1,319 @@
+#ifndef PRUNING_LIBRARY_HPP
+#define PRUNING_LIBRARY_HPP
+
+#include <bits/stdc++.h>
+using namespace std;
+
+#include "datasetLibrary.hpp"
+#include "DTLibrary.hpp"
+
+// Post-pruning of trained trees. Pruning turns internal nodes into leaves;
+// they already predict the majority class of their training rows (see
+// Node::label), so no statistics are recomputed. Afterwards the node array is
+// compacted, so memory and prediction cost shrink with the tree.
+
+// Makes every internal node i with makeLeaf[i] a leaf, drops the nodes below
+// it and rebuilds the arrays in breadth-first order, as flatten does
+void collapseNodes(DecisionTree &tree, const vector<char> &makeLeaf) {
+    size_t classCount = tree.classNames.size();
+    vector<Node> nodes;
+    vector<uint32_t> classCounts;
+    vector<uint64_t> categorySets;
+    vector<uint32_t> levelStart = {0};
+    vector<uint32_t> order = {0};
+    size_t levelEnd = 1;
+    for (size_t i = 0; i < order.size(); ++i) {
+        uint32_t old = order[i];
+        Node node = tree.nodes[old];
+        if (node.kind != NodeKind::Leaf && makeLeaf[old]) {
+            node.kind = NodeKind::Leaf;
+            node.feature = -1;
+            node.threshold = 0;
+            node.childCount = 0;
+        }
+        if (node.kind != NodeKind::Leaf) {
+            uint32_t firstChild = node.firstChild;
+            node.firstChild = order.size();
+            for (uint32_t c = 0; c < node.childCount; ++c) {
+                order.push_back(firstChild + c);
+            }
+        } else {
+            node.firstChild = order.size();
+        }
+        if (node.kind == NodeKind::CategorySet) {
+            const uint64_t *set = tree.categorySets.data() + node.categorySet;
+            size_t words = 1 + (set[0] + 63) / 64;
+            node.categorySet = categorySets.size();
+            categorySets.insert(categorySets.end(), set, set + words);
+        }
+        nodes.push_back(node);
+        classCounts.insert(classCounts.end(), tree.classCounts.begin() + old * classCount,
+                           tree.classCounts.begin() + (old + 1) * classCount);
+        if (i + 1 == levelEnd && order.size() > levelEnd) {
+            levelStart.push_back(levelEnd);
+            levelEnd = order.size();
+        }
+    }
+    levelStart.push_back(nodes.size());
+    tree.nodes = move(nodes);
+    tree.classCounts = move(classCounts);
+    tree.categorySets = move(categorySets);
+    tree.levelStart = move(levelStart);
+}
+
+// Minimal cost-complexity pruning (Breiman et al.). The cost of a tree is
+// R + alpha * leaves, where R is the share of training rows its leaves
+// misclassify. Returns, per node, the smallest alpha at which the node is a
+// leaf of the cheapest subtree (0 for leaves); the values never grow from a
+// node to its children, so one alpha cuts the tree at every node whose value
+// is <= alpha. The whole path comes from one weakest-link sweep: starting at
+// the bottom, the internal node whose collapse costs the least error per
+// leaf removed collapses next, and its ancestors' costs are updated.
+// O(n * depth * log n).
+vector<double> costComplexityAlphas(const DecisionTree &tree) {
+    size_t n = tree.nodes.size();
+    size_t classCount = tree.classNames.size();
+    vector<double> alphas(n, 0.0);
+    if (n == 0) return alphas;
+
+    // Errors are kept as integer row counts, so updates along the ancestors
+    // are exact
+    vector<uint32_t> parent(n, UINT32_MAX);
+    vector<uint64_t> leafErrors(n), subtreeErrors(n), leaves(n);
+    for (size_t i = 0; i < n; ++i) {
+        const Node &node = tree.nodes[i];
+        for (uint32_t c = 0; c < node.childCount; ++c) parent[node.firstChild + c] = i;
+        const uint32_t *counts = tree.classCounts.data() + i * classCount;
+        uint64_t total = accumulate(counts, counts + classCount, (uint64_t)0);
+        leafErrors[i] = total - (node.label >= 0 ? counts[node.label] : 0);
+    }
+    // Children follow their parents, so a backward pass is bottom-up
+    for (size_t i = n; i-- > 0;) {
+        const Node &node = tree.nodes[i];
+        if (node.isLeaf()) {
+            subtreeErrors[i] = leafErrors[i];
+            leaves[i] = 1;
+            continue;
+        }
+        subtreeErrors[i] = 0;
+        leaves[i] = 0;
+        for (uint32_t c = 0; c < node.childCount; ++c) {
+            subtreeErrors[i] += subtreeErrors[node.firstChild + c];
+            leaves[i] += leaves[node.firstChild + c];
+        }
+    }
+    uint64_t rows = accumulate(tree.classCounts.begin(), tree.classCounts.begin() + classCount, (uint64_t)0);
+    double rowCount = max<uint64_t>(rows, 1);
+
+    // Error added per leaf removed when internal node i collapses. The row
+    // counts are divided first, so equal ratios give equal alphas.
+    auto weakness = [&](size_t i) {
+        if (leaves[i] <= 1) return 0.0;
+        return ((double)leafErrors[i] - (double)subtreeErrors[i]) / (leaves[i] - 1) / rowCount;
+    };
+    typedef tuple<double, uint32_t, uint32_t> Entry;
+    priority_queue<Entry, vector<Entry>, greater<Entry>> queue;
+    vector<uint32_t> version(n, 0);
+    // Collapsed nodes and everything below them
+    vector<char> gone(n, 0);
+    vector<double> collapsedAt(n, numeric_limits<double>::infinity());
+    for (size_t i = 0; i < n; ++i) {
+        if (!tree.nodes[i].isLeaf()) queue.emplace(weakness(i), version[i], i);
+    }
+
+    double alpha = 0.0;
+    vector<uint32_t> stack;
+    while (!queue.empty()) {
+        uint32_t i = get<2>(queue.top());
+        double weakest = get<0>(queue.top());
+        bool stale = get<1>(queue.top()) != version[i];
+        queue.pop();
+        if (stale || gone[i]) continue;
+        alpha = max(alpha, weakest);
+        collapsedAt[i] = alpha;
+        stack = {i};
+        while (!stack.empty()) {
+            uint32_t j = stack.back();
+            stack.pop_back();
+            gone[j] = 1;
+            const Node &node = tree.nodes[j];
+            for (uint32_t c = 0; c < node.childCount; ++c) {
+                if (!gone[node.firstChild + c]) stack.push_back(node.firstChild + c);
+            }
+        }
+        uint64_t errorsAdded = leafErrors[i] - subtreeErrors[i];
+        uint64_t leavesRemoved = leaves[i] - 1;
+        for (uint32_t a = parent[i]; a != UINT32_MAX; a = parent[a]) {
+            subtreeErrors[a] += errorsAdded;
+            leaves[a] -= leavesRemoved;
+            queue.emplace(weakness(a), ++version[a], a);
+        }
+    }
+
+    // A node is a leaf as soon as it or an ancestor has collapsed
+    for (size_t i = 0; i < n; ++i) {
+        if (tree.nodes[i].isLeaf()) continue;
+        alphas[i] = collapsedAt[i];
+        if (parent[i] != UINT32_MAX) alphas[i] = min(alphas[i], alphas[parent[i]]);
+    }
+    return alphas;
+}
+
+// The distinct trees of the cost-complexity path, from the full tree
+// (alpha 0, with splits that remove no training error already cut) to the
+// root alone
+class PruningPath {
+public:
+    // Node alphas (see costComplexityAlphas)
+    vector<double> nodeAlphas;
+    // Step k is the tree cut at alphas[k], with sizes[k] nodes and leaves[k]
+    // leaves; alphas increase and sizes shrink
+    vector<double> alphas;
+    vector<int> sizes;
+    vector<int> leaves;
+};
+
+PruningPath costComplexityPath(const DecisionTree &tree) {
+    PruningPath path;
+    path.nodeAlphas = costComplexityAlphas(tree);
+    const vector<double> &nodeAlphas = path.nodeAlphas;
+    path.alphas = {0.0};
+    for (size_t i = 0; i < tree.nodes.size(); ++i) {
+        if (!tree.nodes[i].isLeaf()) path.alphas.push_back(nodeAlphas[i]);
+    }
+    sort(path.alphas.begin(), path.alphas.end());
+    path.alphas.erase(unique(path.alphas.begin(), path.alphas.end()), path.alphas.end());
+
+    // At alpha, a node is kept while its parent's alpha is above it, and
+    // it is a leaf unless its own alpha is
+    vector<double> keptWhile, internalWhile;
+    for (size_t i = 0; i < tree.nodes.size(); ++i) {
+        const Node &node = tree.nodes[i];
+        if (node.isLeaf()) continue;
+        internalWhile.push_back(nodeAlphas[i]);
+        for (uint32_t c = 0; c < node.childCount; ++c) keptWhile.push_back(nodeAlphas[i]);
+    }
+    sort(keptWhile.begin(), keptWhile.end());
+    sort(internalWhile.begin(), internalWhile.end());
+    for (double alpha : path.alphas) {
+        int kept = 1 + (keptWhile.end() - upper_bound(keptWhile.begin(), keptWhile.end(), alpha));
+        int internal = internalWhile.end() - upper_bound(internalWhile.begin(), internalWhile.end(), alpha);
+        path.sizes.push_back(kept);
+        path.leaves.push_back(kept - internal);
+    }
+    return path;
+}
+
+// Cuts the tree at `alpha` of its cost-complexity path
+void pruneCostComplexity(DecisionTree &tree, double alpha) {
+    vector<double> nodeAlphas = costComplexityAlphas(tree);
+    vector<char> makeLeaf(tree.nodes.size(), 0);
+    for (size_t i = 0; i < tree.nodes.size(); ++i) {
+        makeLeaf[i] = !tree.nodes[i].isLeaf() && nodeAlphas[i] <= alpha;
+    }
+    collapseNodes(tree, makeLeaf);
+}
+
+// Accuracy (%) on `validation` of every tree of `path`, from one routing of
+// each row: a row is predicted by the shallowest node of its path that is a
+// leaf at alpha, so its prediction only changes at the alphas of that path
+vector<double> pathAccuracies(const DecisionTree &tree, const PruningPath &path, const Dataset &validation) {
+    const vector<double> &alphas = path.alphas;
+    vector<long long> correct(alphas.size() + 1, 0);
+    // Adds 1 to every step with alpha in [low, high)
+    auto count = [&](double low, double high) {
+        size_t begin = lower_bound(alphas.begin(), alphas.end(), low) - alphas.begin();
+        size_t end = lower_bound(alphas.begin(), alphas.end(), high) - alphas.begin();
+        if (begin < end) {
+            correct[begin]++;
+            correct[end]--;
+        }
+    };
+    for (size_t row = 0; row < validation.size() && !tree.nodes.empty(); ++row) {
+        int label = validation.labels[row];
+        double above = numeric_limits<double>::infinity();
+        uint32_t at = 0;
+        while (true) {
+            const Node &node = tree.nodes[at];
+            double alpha = node.isLeaf() ? 0.0 : path.nodeAlphas[at];
+            if (node.label == label) count(alpha, above);
+            if (node.isLeaf()) break;
+            above = alpha;
+            at = tree.nextNode(at, validation, row);
+            if (at == UINT32_MAX) {
+                // Stuck below a node that is still internal
+                if (tree.defaultClass == label) count(0.0, above);
+                break;
+            }
+        }
+    }
+    vector<double> accuracies;
+    long long running = 0;
+    for (size_t k = 0; k < alphas.size(); ++k) {
+        running += correct[k];
+        accuracies.push_back(validation.size() ? 100.0 * running / validation.size() : 0.0);
+    }
+    return accuracies;
+}
+
+// Cuts the tree to the smallest one on its cost-complexity path whose
+// accuracy on `validation` is within `tolerance` percentage points of the
+// best one. Returns the alpha used.
+double pruneWithinTolerance(DecisionTree &tree, const Dataset &validation, double tolerance) {
+    PruningPath path = costComplexityPath(tree);
+    vector<double> accuracies = pathAccuracies(tree, path, validation);
+    double best = *max_element(accuracies.begin(), accuracies.end());
+    size_t chosen = 0;
+    for (size_t k = 0; k < accuracies.size(); ++k) {
+        if (accuracies[k] >= best - tolerance) chosen = k;
+    }
+    pruneCostComplexity(tree, path.alphas[chosen]);
+    return path.alphas[chosen];
+}
+
+// Reduced-error pruning (Quinlan): bottom-up, every internal node becomes a
+// leaf if that predicts at least as many `validation` rows correctly as its
+// (already pruned) subtree does. Nodes no validation row reaches are cut.
+void pruneReducedError(DecisionTree &tree, const Dataset &validation) {
+    size_t n = tree.nodes.size();
+    if (n == 0) return;
+    // Rows reaching each node that its label gets right, and rows stuck at
+    // an internal node that the default class gets right
+    vector<long long> leafCorrect(n, 0), stuckCorrect(n, 0);
+    for (size_t row = 0; row < validation.size(); ++row) {
+        int label = validation.labels[row];
+        uint32_t at = 0;
+        while (true) {
+            const Node &node = tree.nodes[at];
+            leafCorrect[at] += node.label == label;
+            if (node.isLeaf()) break;
+            uint32_t next = tree.nextNode(at, validation, row);
+            if (next == UINT32_MAX) {
+                stuckCorrect[at] += tree.defaultClass == label;
+                break;
+            }
+            at = next;
+        }
+    }
+
+    vector<long long> subtreeCorrect(n, 0);
+    vector<char> makeLeaf(n, 0);
+    for (size_t i = n; i-- > 0;) {
+        const Node &node = tree.nodes[i];
+        if (node.isLeaf()) {
+            subtreeCorrect[i] = leafCorrect[i];
+            continue;
+        }
+        subtreeCorrect[i] = stuckCorrect[i];
+        for (uint32_t c = 0; c < node.childCount; ++c) {
+            subtreeCorrect[i] += subtreeCorrect[node.firstChild + c];
+        }
+        if (leafCorrect[i] >= subtreeCorrect[i]) {
+            makeLeaf[i] = 1;
+            subtreeCorrect[i] = leafCorrect[i];
+        }
+    }
+    collapseNodes(tree, makeLeaf);
+}
+
+#endif // PRUNING_LIBRARY_HPP